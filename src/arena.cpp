@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "arena.hpp"
+
+static const char *kind_name[] = {
+    "integer", "zero_init", "undef", "aggregate", "func_arg_ref", "block_arg_ref", "alloc", "global_alloc",
+    "load", "store", "get_ptr", "get_elem_ptr", "binary", "branch", "jump", "call", "return",
+    "type", "basic_block", "function", "slice", "name"
+};
+
+Arena::Arena(void) : cur(nullptr), left(0)
+{
+    std::fill(bytes, bytes + KIND_COUNT, 0);
+    std::fill(count, count + KIND_COUNT, 0);
+
+    return;
+}
+
+Arena::~Arena(void)
+{
+    clear();
+
+    return;
+}
+
+void *Arena::alloc(size_t size, size_t align, int kind)
+{
+    size_t pad = (align - (size_t)cur % align) % align;
+
+    if(pad + size > left)
+    {
+        size_t block_size = std::max(BLOCK_SIZE, size + align);
+        cur = (char *)malloc(block_size);
+        if(!cur)
+            throw std::bad_alloc();
+        blocks.push_back(cur);
+        left = block_size;
+        pad = (align - (size_t)cur % align) % align;
+    }
+
+    void *res = cur + pad;
+    cur += pad + size;
+    left -= pad + size;
+    bytes[kind] += size;
+    count[kind] ++;
+
+    return res;
+}
+
+void Arena::clear(void)
+{
+    for(auto block : blocks)
+        free(block);
+    blocks.clear();
+    cur = nullptr;
+    left = 0;
+    std::fill(bytes, bytes + KIND_COUNT, 0);
+    std::fill(count, count + KIND_COUNT, 0);
+
+    return;
+}
+
+void Arena::report(std::ostream &os)
+{
+    size_t total = 0;
+
+    for(int i = 0; i < KIND_COUNT; i ++)
+    {
+        if(!count[i])
+            continue;
+        os << "arena: " << kind_name[i] << " " << count[i] << " nodes, " << bytes[i] << " bytes\n";
+        total += bytes[i];
+    }
+    os << "arena: total " << total << " bytes in " << blocks.size() << " blocks\n";
+
+    return;
+}
+
+const void **Arena::slice(const std::vector<void *> &vec)
+{
+    auto buffer = (const void **)alloc(sizeof(void *) * std::max<size_t>(vec.size(), 1), alignof(void *), SLICE);
+    std::copy(vec.begin(), vec.end(), buffer);
+
+    return buffer;
+}
+
+char *Arena::name(const std::string &s)
+{
+    char *res = (char *)alloc(s.size() + 1, 1, NAME);
+    res[s.copy(res, s.size())] = 0;
+
+    return res;
+}
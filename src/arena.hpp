@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "koopa.h"
+
+// 一次编译中所有 Koopa IR 结点的线性分配器, 编译结束后整体释放
+class Arena
+{
+public:
+    enum Kind
+    {
+        VALUE,
+        TYPE = VALUE + KOOPA_RVT_RETURN + 1,
+        BLOCK,
+        FUNCTION,
+        SLICE,
+        NAME,
+        KIND_COUNT
+    };
+
+private:
+    static constexpr size_t BLOCK_SIZE = 1U << 20;
+
+    std::vector<char *> blocks;
+    char *cur;
+    size_t left;
+    size_t bytes[KIND_COUNT], count[KIND_COUNT];
+
+    static int kind_of(const koopa_raw_value_data &)
+    {
+        return VALUE;
+    }
+    static int kind_of(const koopa_raw_type_kind &)
+    {
+        return TYPE;
+    }
+    static int kind_of(const koopa_raw_basic_block_data_t &)
+    {
+        return BLOCK;
+    }
+    static int kind_of(const koopa_raw_function_data_t &)
+    {
+        return FUNCTION;
+    }
+
+public:
+    Arena(void);
+    ~Arena(void);
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *alloc(size_t size, size_t align, int kind);
+    void clear(void);
+    void report(std::ostream &os);
+
+    template<typename T>
+    T *make(const T &init)
+    {
+        int kind = kind_of(init);
+        if constexpr(std::is_same_v<T, koopa_raw_value_data>)
+            kind += init.kind.tag;
+        return new(alloc(sizeof(T), alignof(T), kind)) T(init);
+    }
+
+    const void **slice(const std::vector<void *> &vec);
+    char *name(const std::string &s);
+};
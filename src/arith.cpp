@@ -0,0 +1,232 @@
+#include <vector>
+#include "arith.hpp"
+#include "mir.hpp"
+
+// 指令序列的估计代价, 用来在候选的模式中选择
+static const int MUL_COST = 3, DIV_COST = 20;
+
+static int li_cost(int imm)
+{
+    return imm >= -2048 && imm <= 2047 ? 1 : 2;
+}
+
+// 乘以常数: |c| 为 2^a, 2^a + 2^b 或 2^a - 2^b 时用移位和加减, 比 li + mul 便宜才使用
+bool mul_const(MFunc &func, std::vector<MInst> &insts, int lhs, int c, int dst)
+{
+    unsigned m = c < 0 ? 0U - (unsigned)c : (unsigned)c;
+
+    if(!m)
+    {
+        insts.push_back(MInst(RV_MV, dst, ZERO));
+        return true;
+    }
+
+    unsigned low = m & -m;
+    int a, b = __builtin_ctz(m), cost = c < 0;
+    RVOp op;
+    if(m == low)
+    {
+        a = b;
+        op = RV_MV;
+        cost += a != 0;
+    }
+    else if(__builtin_popcount(m) == 2)
+    {
+        a = 31 - __builtin_clz(m);
+        op = RV_ADD;
+        cost += 2 + (b != 0);
+    }
+    else if(m + low && !((m + low) & (m + low - 1)))
+    {
+        a = __builtin_ctz(m + low);
+        op = RV_SUB;
+        cost += 2 + (b != 0);
+    }
+    else
+        return false;
+    if(cost >= li_cost(c) + MUL_COST)
+        return false;
+
+    int res = c < 0 ? func.vreg() : dst;
+    if(op == RV_MV)
+    {
+        if(a)
+            insts.push_back(MInst(RV_SLLI, res, lhs, -1, a));
+        else if(c > 0)
+            insts.push_back(MInst(RV_MV, res, lhs));
+        else
+            res = lhs;
+    }
+    else
+    {
+        int high = func.vreg(), shifted = lhs;
+        insts.push_back(MInst(RV_SLLI, high, lhs, -1, a));
+        if(b)
+        {
+            shifted = func.vreg();
+            insts.push_back(MInst(RV_SLLI, shifted, lhs, -1, b));
+        }
+        insts.push_back(MInst(op, res, high, shifted));
+    }
+    if(c < 0)
+        insts.push_back(MInst(RV_SUB, dst, ZERO, res));
+
+    return true;
+}
+
+// 有符号除以常数 d (|d| >= 2) 的魔数 M 和移位量 s: x / d = (mulh(x, M) [+- x]) >> s, 再对负数加 1
+int magic(int d, int &shift)
+{
+    const unsigned two31 = 1U << 31;
+    unsigned ad = d < 0 ? 0U - (unsigned)d : (unsigned)d;
+    unsigned t = two31 + ((unsigned)d >> 31);
+    unsigned anc = t - 1 - t % ad;
+    unsigned q1 = two31 / anc, r1 = two31 - q1 * anc;
+    unsigned q2 = two31 / ad, r2 = two31 - q2 * ad;
+    unsigned delta;
+    int p = 31;
+
+    do
+    {
+        p ++;
+        q1 *= 2;
+        r1 *= 2;
+        if(r1 >= anc)
+        {
+            q1 ++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if(r2 >= ad)
+        {
+            q2 ++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while(q1 < delta || (q1 == delta && r1 == 0));
+
+    shift = p - 32;
+
+    return d < 0 ? -(int)(q2 + 1) : (int)(q2 + 1);
+}
+
+// 除以 ±2^k: 负数先加上 2^k - 1 使得结果向零取整
+static void div_pow2(MFunc &func, std::vector<MInst> &insts, bool mod, int lhs, int c, int k, int dst)
+{
+    int sign = lhs, bias = func.vreg(), sum = func.vreg();
+
+    if(k > 1)
+    {
+        sign = func.vreg();
+        insts.push_back(MInst(RV_SRAI, sign, lhs, -1, 31));
+    }
+    insts.push_back(MInst(RV_SRLI, bias, sign, -1, 32 - k));
+    insts.push_back(MInst(RV_ADD, sum, lhs, bias));
+    if(mod)
+    {
+        int mask = func.vreg();
+        if(k <= 11)
+            insts.push_back(MInst(RV_ANDI, mask, sum, -1, -(1 << k)));
+        else
+        {
+            int quot = func.vreg();
+            insts.push_back(MInst(RV_SRAI, quot, sum, -1, k));
+            insts.push_back(MInst(RV_SLLI, mask, quot, -1, k));
+        }
+        insts.push_back(MInst(RV_SUB, dst, lhs, mask));
+    }
+    else if(c > 0)
+        insts.push_back(MInst(RV_SRAI, dst, sum, -1, k));
+    else
+    {
+        int quot = func.vreg();
+        insts.push_back(MInst(RV_SRAI, quot, sum, -1, k));
+        insts.push_back(MInst(RV_SUB, dst, ZERO, quot));
+    }
+
+    return;
+}
+
+// 除以其他常数: 用 mulh 乘以魔数代替 div
+static void div_magic(MFunc &func, std::vector<MInst> &insts, int lhs, int c, int magic_num, int shift, int dst)
+{
+    int num = func.vreg(), high = func.vreg(), quot = high, sign = func.vreg();
+
+    insts.push_back(MInst(RV_LI, num, -1, -1, magic_num));
+    insts.push_back(MInst(RV_MULH, high, lhs, num));
+    if((c > 0 && magic_num < 0) || (c < 0 && magic_num > 0))
+    {
+        quot = func.vreg();
+        insts.push_back(MInst(c > 0 ? RV_ADD : RV_SUB, quot, high, lhs));
+    }
+    if(shift)
+    {
+        int shifted = func.vreg();
+        insts.push_back(MInst(RV_SRAI, shifted, quot, -1, shift));
+        quot = shifted;
+    }
+    insts.push_back(MInst(RV_SRLI, sign, quot, -1, 31));
+    insts.push_back(MInst(RV_ADD, dst, quot, sign));
+
+    return;
+}
+
+// 除以或者对常数取余, 余数为 x - (x / c) * c; 除以 0 的行为留给 div 指令
+bool div_const(MFunc &func, std::vector<MInst> &insts, bool mod, int lhs, int c, int dst)
+{
+    unsigned m = c < 0 ? 0U - (unsigned)c : (unsigned)c;
+
+    if(!m)
+        return false;
+    if(m == 1)
+    {
+        if(mod)
+            insts.push_back(MInst(RV_MV, dst, ZERO));
+        else if(c > 0)
+            insts.push_back(MInst(RV_MV, dst, lhs));
+        else
+            insts.push_back(MInst(RV_SUB, dst, ZERO, lhs));
+        return true;
+    }
+    if(!(m & (m - 1)) && m != 1U << 31)
+    {
+        int k = __builtin_ctz(m);
+        if((k > 1) + 3 + (mod ? (k > 11) : c < 0) >= li_cost(c) + DIV_COST)
+            return false;
+        div_pow2(func, insts, mod, lhs, c, k, dst);
+        return true;
+    }
+
+    int shift = 0, magic_num = m == 1U << 31 ? 0 : magic(c, shift);
+    int cost = m == 1U << 31 ? 3 : li_cost(magic_num) + MUL_COST + 4;
+    if(mod)
+        cost += li_cost(c) + MUL_COST + 1;
+    if(cost >= li_cost(c) + DIV_COST)
+        return false;
+
+    int quot = !mod ? dst : func.vreg();
+    if(m == 1U << 31)
+    {
+        // 只有 INT_MIN 自己除以 INT_MIN 的商不为 0
+        int num = func.vreg(), diff = func.vreg();
+        insts.push_back(MInst(RV_LI, num, -1, -1, c));
+        insts.push_back(MInst(RV_XOR, diff, lhs, num));
+        insts.push_back(MInst(RV_SEQZ, quot, diff));
+    }
+    else
+        div_magic(func, insts, lhs, c, magic_num, shift, quot);
+    if(mod)
+    {
+        int prod = func.vreg();
+        if(!mul_const(func, insts, quot, c, prod))
+        {
+            int num = func.vreg();
+            insts.push_back(MInst(RV_LI, num, -1, -1, c));
+            insts.push_back(MInst(RV_MUL, prod, quot, num));
+        }
+        insts.push_back(MInst(RV_SUB, dst, lhs, prod));
+    }
+
+    return true;
+}
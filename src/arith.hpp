@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+#include "mir.hpp"
+
+// 常数乘除法的强度削弱: 展开的指令追加到 insts 末尾, 新的虚拟寄存器从 func 中分配
+// 不比 li 加上 mul, div 或 rem 便宜时返回 false, 不生成指令; mod 为 true 时求余数
+bool mul_const(MFunc &func, std::vector<MInst> &insts, int lhs, int c, int dst);
+bool div_const(MFunc &func, std::vector<MInst> &insts, bool mod, int lhs, int c, int dst);
+
+// 有符号除以常数 d (2 <= |d| < 2^31) 的魔数 M 和移位量 shift
+int magic(int d, int &shift);
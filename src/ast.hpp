@@ -4,8 +4,8 @@
 #include <string>
 #include <tuple>
 #include <vector>
+#include "context.hpp"
 #include "koopa.h"
-#include "table.hpp"
 
 enum InstType
 {
@@ -19,21 +19,37 @@ enum InstType
     CONTINUE
 };
 
+enum OpType
+{
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_NOT,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,
+    OP_OR
+};
+
 // 所有 AST 的基类
 class BaseAST
 {
 friend class BlockInst;
 
 protected:
-    static SymbolList symbol_list;
-    static BlockInst block_inst;
-    static std::vector<std::tuple<koopa_raw_basic_block_data_t *, koopa_raw_basic_block_data_t *, koopa_raw_basic_block_data_t *>> loop_inst;
-
     const void **vector_data(std::vector<void *> &vec);
     char *string_data(std::string s);
-    koopa_raw_type_kind *array_data(std::vector<int> &sz, int pos);
+    koopa_raw_type_t array_data(std::vector<int> &sz, int pos);
 
 public:
+    static thread_local Context *context;
+
     virtual ~BaseAST(void) = default;
     virtual void *to_koopa(void);
     virtual int value(void);
@@ -47,6 +63,9 @@ private:
     std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>> value_vec;
 
     void libfuncs(std::vector<void*> &funcs);
+    void link_used_by(std::vector<void *> &funcs);
+    void tail_recursion(koopa_raw_function_data_t *kfunc);
+    void mem2reg(koopa_raw_function_data_t *kfunc);
 
 public:
     CompUnitAST(std::vector<std::unique_ptr<BaseAST>> &_func_vec, std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>> &_value_vec);
@@ -85,7 +104,7 @@ public:
     FuncFParamAST(ParamType _type, std::string _ident, int _index);
     FuncFParamAST(ParamType _type, std::string _ident, int _index, std::vector<std::unique_ptr<BaseAST>> &_sz_exp);
 
-    koopa_raw_type_kind *get_type(void);
+    koopa_raw_type_t get_type(void);
     void *to_koopa(void);
 };
 
@@ -241,6 +260,7 @@ private:
         ARRAY
     } type;
     std::string ident;
+    int id;
     std::vector<std::unique_ptr<BaseAST>> idx_vec;
 
 public:
@@ -273,13 +293,14 @@ private:
         OP,
         FUNCTION
     } type;
-    std::string op;
+    OpType op;
+    std::string ident;
     std::unique_ptr<BaseAST> next_exp;
     std::vector<std::unique_ptr<BaseAST>> rparams;
 
 public:
     UnaryExpAST(std::unique_ptr<BaseAST> &_primary_exp);
-    UnaryExpAST(std::string _op, std::unique_ptr<BaseAST> &_unary_exp);
+    UnaryExpAST(OpType _op, std::unique_ptr<BaseAST> &_unary_exp);
     UnaryExpAST(std::string _ident, std::vector<std::unique_ptr<BaseAST>> &_rparams);
 
     void *to_koopa(void);
@@ -294,13 +315,13 @@ private:
         PRIMARY,
         OP
     } type;
-    std::string op;
+    OpType op;
     std::unique_ptr<BaseAST> left_exp;
     std::unique_ptr<BaseAST> right_exp;
 
 public:
     MulExpAST(std::unique_ptr<BaseAST> &_primary_exp);
-    MulExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp);
+    MulExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp);
 
     void *to_koopa(void);
     int value(void);
@@ -314,13 +335,13 @@ private:
         PRIMARY,
         OP
     } type;
-    std::string op;
+    OpType op;
     std::unique_ptr<BaseAST> left_exp;
     std::unique_ptr<BaseAST> right_exp;
 
 public:
     AddExpAST(std::unique_ptr<BaseAST> &_primary_exp);
-    AddExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp);
+    AddExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp);
 
     void *to_koopa(void);
     int value(void);
@@ -334,12 +355,12 @@ public:
         PRIMARY,
         OP
     } type;
-    std::string op;
+    OpType op;
     std::unique_ptr<BaseAST> left_exp;
     std::unique_ptr<BaseAST> right_exp;
 
     RelExpAST(std::unique_ptr<BaseAST> &_primary_exp);
-    RelExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp);
+    RelExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp);
 
     void *to_koopa(void);
     int value(void);
@@ -353,13 +374,13 @@ private:
         PRIMARY,
         OP
     } type;
-    std::string op;
+    OpType op;
     std::unique_ptr<BaseAST> left_exp;
     std::unique_ptr<BaseAST> right_exp;
 
 public:
     EqExpAST(std::unique_ptr<BaseAST> &_primary_exp);
-    EqExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp);
+    EqExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp);
 
     void *to_koopa(void);
     int value(void);
@@ -373,13 +394,13 @@ private:
         PRIMARY,
         OP
     } type;
-    std::string op;
+    OpType op;
     std::unique_ptr<BaseAST> left_exp;
     std::unique_ptr<BaseAST> right_exp;
 
 public:
     LAndExpAST(std::unique_ptr<BaseAST> &_primary_exp);
-    LAndExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp);
+    LAndExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp);
 
     void *to_koopa(void);
     int value(void);
@@ -393,13 +414,13 @@ private:
         PRIMARY,
         OP
     } type;
-    std::string op;
+    OpType op;
     std::unique_ptr<BaseAST> left_exp;
     std::unique_ptr<BaseAST> right_exp;
 
 public:
     LOrExpAST(std::unique_ptr<BaseAST> &_primary_exp);
-    LOrExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp);
+    LOrExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp);
 
     void *to_koopa(void);
     int value(void);
@@ -30,7 +30,7 @@ void InitValAST::sub_preprocess(std::vector<int> &pro, int align, std::vector<ko
         if(t->type == EXP)
         {
             if(is_const)
-                buf.push_back(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = t->exp->value()}});
+                buf.push_back(context->const_pool.integer(t->exp->value()));
             else
                 buf.push_back((koopa_raw_value_t)t->exp->to_koopa());
         }
@@ -43,7 +43,7 @@ void InitValAST::sub_preprocess(std::vector<int> &pro, int align, std::vector<ko
         }
     }
     while((int)buf.size() < target_size)
-        buf.push_back(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = 0}});
+        buf.push_back(context->const_pool.integer(0));
 
     return;
 }
@@ -75,7 +75,7 @@ koopa_raw_value_t InitValAST::sub_make_aggerate(std::vector<int> &sz, std::vecto
     if(pro[align] == 1)
         return buf[pos];
 
-    koopa_raw_value_data *res = new koopa_raw_value_data{array_data(sz, align), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_AGGREGATE}};
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{array_data(sz, align), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_AGGREGATE}});
     std::vector<void *> elems;
 
     for(int i = 0; i < sz[align]; i ++)
@@ -101,8 +101,8 @@ koopa_raw_value_data *ArrayDefAST::index(int i, std::vector<int> &pro, koopa_raw
     if(pos >= (int)pro.size())
         return src;
 
-    koopa_raw_value_data *get = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = i / pro[pos]}}}};
-    block_inst.add_inst(get);
+    koopa_raw_value_data *get = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = context->const_pool.integer(i / pro[pos])}});
+    context->block_inst.add_inst(get);
 
     return index(i % pro[pos], pro, get, pos + 1);
 }
@@ -135,9 +135,9 @@ void *ArrayDefAST::to_koopa(void)
         sz.push_back(tmp);
     }
 
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = array_data(sz, 0)}, string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ALLOC}};
-    block_inst.add_inst(res);
-    symbol_list.add_symbol(ident, {LVal::ARRAY, res});
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.pointer(array_data(sz, 0)), string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ALLOC}});
+    context->block_inst.add_inst(res);
+    context->symbol_list.add_symbol(ident, {LVal::ARRAY, res});
 
     if(init_val)
     {
@@ -150,7 +150,7 @@ void *ArrayDefAST::to_koopa(void)
             pro[i] = pro[i + 1] * sz[i + 1];
 
         for(int i = 0; i < total; i ++)
-            block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_STORE, .data.store.value = t->index(i), .data.store.dest = index(i, pro, res, 0)}});
+            context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_STORE, .data.store.value = t->index(i), .data.store.dest = index(i, pro, res, 0)}}));
     }
 
     return res;
@@ -175,8 +175,8 @@ void *GlobalArrayDefAST::to_koopa(void)
     for(auto &exp : sz_exp)
         sz.push_back(exp->value());
 
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = array_data(sz, 0)}, string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GLOBAL_ALLOC}};
-    symbol_list.add_symbol(ident, {LVal::ARRAY, res});
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.pointer(array_data(sz, 0)), string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GLOBAL_ALLOC}});
+    context->symbol_list.add_symbol(ident, {LVal::ARRAY, res});
 
     if(init_val)
     {
@@ -186,7 +186,7 @@ void *GlobalArrayDefAST::to_koopa(void)
         res->kind.data.global_alloc.init = t->make_aggerate(sz);
     }
     else
-        res->kind.data.global_alloc.init = new koopa_raw_value_data{array_data(sz, 0), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ZERO_INIT}};
+        res->kind.data.global_alloc.init = context->arena.make(koopa_raw_value_data{array_data(sz, 0), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ZERO_INIT}});
 
     return res;
 }
@@ -1,54 +1,535 @@
+#include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "../ast.hpp"
+#include "../cfg.hpp"
+#include "../koopa_util.hpp"
 
 void CompUnitAST::libfuncs(std::vector<void*> &funcs)
 {
     koopa_raw_function_data_t *res;
-    std::vector<void *> fparams;
+    std::vector<koopa_raw_type_t> fparams;
 
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {nullptr, 0, KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}, "@getint", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("getint", {LVal::FUNCTION, res});
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function({}, context->type_table.int32()), "@getint", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("getint", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {nullptr, 0, KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}, "@getch", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("getch", {LVal::FUNCTION, res});
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function({}, context->type_table.int32()), "@getch", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("getch", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
-    fparams = {new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}};
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {vector_data(fparams), (unsigned)fparams.size(), KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}, "@getarray", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("getarray", {LVal::FUNCTION, res});
+    fparams = {context->type_table.pointer(context->type_table.int32())};
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function(fparams, context->type_table.int32()), "@getarray", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("getarray", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
-    fparams = {new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}};
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {vector_data(fparams), (unsigned)fparams.size(), KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}}, "@putint", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("putint", {LVal::FUNCTION, res});
+    fparams = {context->type_table.int32()};
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function(fparams, context->type_table.unit()), "@putint", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("putint", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
-    fparams = {new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}};
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {vector_data(fparams), (unsigned)fparams.size(), KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}}, "@putch", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("putch", {LVal::FUNCTION, res});
+    fparams = {context->type_table.int32()};
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function(fparams, context->type_table.unit()), "@putch", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("putch", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
-    fparams = {new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}};
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {vector_data(fparams), (unsigned)fparams.size(), KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}}, "@putarray", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("putarray", {LVal::FUNCTION, res});
+    fparams = {context->type_table.int32(), context->type_table.pointer(context->type_table.int32())};
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function(fparams, context->type_table.unit()), "@putarray", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("putarray", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {nullptr, 0, KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}}, "@starttime", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("starttime", {LVal::FUNCTION, res});
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function({}, context->type_table.unit()), "@starttime", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("starttime", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
-    res = new koopa_raw_function_data_t{new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {nullptr, 0, KOOPA_RSIK_TYPE}, .data.function.ret = new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}}, "@stoptime", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}};
-    symbol_list.add_symbol("stoptime", {LVal::FUNCTION, res});
+    res = context->arena.make(koopa_raw_function_data_t{context->type_table.function({}, context->type_table.unit()), "@stoptime", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_BASIC_BLOCK}});
+    context->symbol_list.add_symbol("stoptime", {LVal::FUNCTION, res});
     funcs.push_back(res);
 
     return;
 }
 
+template<typename T>
+static void add_use(std::map<T, std::vector<void *>> &users, T used, koopa_raw_value_t user)
+{
+    if(used)
+        users[used].push_back((void *)user);
+
+    return;
+}
+
+static void add_use(std::map<koopa_raw_value_t, std::vector<void *>> &users, const koopa_raw_slice_t &used, koopa_raw_value_t user)
+{
+    for(int i = 0; i < (int)used.len; i ++)
+        add_use(users, (koopa_raw_value_t)used.buffer[i], user);
+
+    return;
+}
+
+void CompUnitAST::link_used_by(std::vector<void *> &funcs)
+{
+    std::map<koopa_raw_value_t, std::vector<void *>> value_users;
+    std::map<koopa_raw_basic_block_t, std::vector<void *>> block_users;
+
+    for(auto &func : funcs)
+    {
+        koopa_raw_function_t kfunc = (koopa_raw_function_t)func;
+        for(int i = 0; i < (int)kfunc->bbs.len; i ++)
+        {
+            koopa_raw_basic_block_t kblk = (koopa_raw_basic_block_t)kfunc->bbs.buffer[i];
+            for(int j = 0; j < (int)kblk->insts.len; j ++)
+            {
+                koopa_raw_value_t kval = (koopa_raw_value_t)kblk->insts.buffer[j];
+                auto &data = kval->kind.data;
+                switch(kval->kind.tag)
+                {
+                case KOOPA_RVT_LOAD:
+                    add_use(value_users, data.load.src, kval);
+                    break;
+                case KOOPA_RVT_STORE:
+                    add_use(value_users, data.store.value, kval);
+                    add_use(value_users, data.store.dest, kval);
+                    break;
+                case KOOPA_RVT_GET_PTR:
+                    add_use(value_users, data.get_ptr.src, kval);
+                    add_use(value_users, data.get_ptr.index, kval);
+                    break;
+                case KOOPA_RVT_GET_ELEM_PTR:
+                    add_use(value_users, data.get_elem_ptr.src, kval);
+                    add_use(value_users, data.get_elem_ptr.index, kval);
+                    break;
+                case KOOPA_RVT_BINARY:
+                    add_use(value_users, data.binary.lhs, kval);
+                    add_use(value_users, data.binary.rhs, kval);
+                    break;
+                case KOOPA_RVT_BRANCH:
+                    add_use(value_users, data.branch.cond, kval);
+                    add_use(value_users, data.branch.true_args, kval);
+                    add_use(value_users, data.branch.false_args, kval);
+                    add_use(block_users, data.branch.true_bb, kval);
+                    add_use(block_users, data.branch.false_bb, kval);
+                    break;
+                case KOOPA_RVT_JUMP:
+                    add_use(value_users, data.jump.args, kval);
+                    add_use(block_users, data.jump.target, kval);
+                    break;
+                case KOOPA_RVT_CALL:
+                    add_use(value_users, data.call.args, kval);
+                    break;
+                case KOOPA_RVT_RETURN:
+                    add_use(value_users, data.ret.value, kval);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+
+    for(auto &[kval, users] : value_users)
+        ((koopa_raw_value_data *)kval)->used_by = {vector_data(users), (unsigned)users.size(), KOOPA_RSIK_VALUE};
+    for(auto &[kblk, users] : block_users)
+        ((koopa_raw_basic_block_data_t *)kblk)->used_by = {vector_data(users), (unsigned)users.size(), KOOPA_RSIK_VALUE};
+
+    return;
+}
+
+// 尾递归消除: 入口块在参数写入局部变量之后拆出循环头
+// 块末尾的 %r = call @self(...); ret %r 改为把实参写回参数变量, 再跳回循环头
+void CompUnitAST::tail_recursion(koopa_raw_function_data_t *kfunc)
+{
+    int n = kfunc->params.len;
+    if(!kfunc->bbs.len)
+        return;
+
+    auto entry = (koopa_raw_basic_block_data_t *)kfunc->bbs.buffer[0];
+    std::vector<koopa_raw_value_t> vars;
+    if((int)entry->insts.len < 2 * n)
+        return;
+    for(int i = 0; i < n; i ++)
+    {
+        auto allo = (koopa_raw_value_t)entry->insts.buffer[2 * i];
+        auto store = (koopa_raw_value_t)entry->insts.buffer[2 * i + 1];
+        if(allo->kind.tag != KOOPA_RVT_ALLOC || store->kind.tag != KOOPA_RVT_STORE || store->kind.data.store.value != kfunc->params.buffer[i] || store->kind.data.store.dest != allo)
+            return;
+        vars.push_back(allo);
+    }
+
+    std::vector<koopa_raw_basic_block_data_t *> tails;
+    for(int i = 0; i < (int)kfunc->bbs.len; i ++)
+    {
+        auto kblk = (koopa_raw_basic_block_data_t *)kfunc->bbs.buffer[i];
+        int m = kblk->insts.len;
+        if(m < 2)
+            continue;
+        auto kcall = (koopa_raw_value_t)kblk->insts.buffer[m - 2];
+        auto kret = (koopa_raw_value_t)kblk->insts.buffer[m - 1];
+        if(kcall->kind.tag != KOOPA_RVT_CALL || kcall->kind.data.call.callee != kfunc || kret->kind.tag != KOOPA_RVT_RETURN)
+            continue;
+        if(kret->kind.data.ret.value != (kcall->ty->tag == KOOPA_RTT_UNIT ? nullptr : kcall))
+            continue;
+        bool local = false;
+        for(int j = 0; j < n; j ++)
+            local |= frame_pointer((koopa_raw_value_t)kcall->kind.data.call.args.buffer[j]);
+        if(!local)
+            tails.push_back(kblk);
+    }
+    if(tails.empty())
+        return;
+
+    koopa_raw_basic_block_data_t *head = context->arena.make(koopa_raw_basic_block_data_t{string_data("%tail_" + std::string(kfunc->name + 1)), {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+    std::vector<void *> prologue((void **)entry->insts.buffer, (void **)entry->insts.buffer + 2 * n), body((void **)entry->insts.buffer + 2 * n, (void **)entry->insts.buffer + entry->insts.len);
+    prologue.push_back(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = head}}));
+    entry->insts = {vector_data(prologue), (unsigned)prologue.size(), KOOPA_RSIK_VALUE};
+    head->insts = {vector_data(body), (unsigned)body.size(), KOOPA_RSIK_VALUE};
+
+    std::vector<void *> blocks((void **)kfunc->bbs.buffer, (void **)kfunc->bbs.buffer + kfunc->bbs.len);
+    blocks.insert(blocks.begin() + 1, head);
+    kfunc->bbs = {vector_data(blocks), (unsigned)blocks.size(), KOOPA_RSIK_BASIC_BLOCK};
+
+    for(auto kblk : tails)
+    {
+        if(kblk == entry)
+            kblk = head;
+        auto kcall = (koopa_raw_value_t)kblk->insts.buffer[kblk->insts.len - 2];
+        std::vector<void *> insts((void **)kblk->insts.buffer, (void **)kblk->insts.buffer + kblk->insts.len - 2);
+        for(int j = 0; j < n; j ++)
+            insts.push_back(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_STORE, .data.store.value = (koopa_raw_value_t)kcall->kind.data.call.args.buffer[j], .data.store.dest = vars[j]}}));
+        insts.push_back(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = head}}));
+        kblk->insts = {vector_data(insts), (unsigned)insts.size(), KOOPA_RSIK_VALUE};
+    }
+
+    return;
+}
+
+// 指令中所有操作数的位置, 用来检查局部变量的用法和替换操作数
+static std::vector<koopa_raw_value_t *> operands(koopa_raw_value_t kval)
+{
+    auto &data = ((koopa_raw_value_data *)kval)->kind.data;
+    std::vector<koopa_raw_value_t *> res;
+    auto add_slice = [&](koopa_raw_slice_t &args)
+    {
+        for(int i = 0; i < (int)args.len; i ++)
+            res.push_back((koopa_raw_value_t *)&args.buffer[i]);
+    };
+
+    switch(kval->kind.tag)
+    {
+    case KOOPA_RVT_LOAD:
+        res.push_back(&data.load.src);
+        break;
+    case KOOPA_RVT_STORE:
+        res.push_back(&data.store.value);
+        res.push_back(&data.store.dest);
+        break;
+    case KOOPA_RVT_GET_PTR:
+        res.push_back(&data.get_ptr.src);
+        res.push_back(&data.get_ptr.index);
+        break;
+    case KOOPA_RVT_GET_ELEM_PTR:
+        res.push_back(&data.get_elem_ptr.src);
+        res.push_back(&data.get_elem_ptr.index);
+        break;
+    case KOOPA_RVT_BINARY:
+        res.push_back(&data.binary.lhs);
+        res.push_back(&data.binary.rhs);
+        break;
+    case KOOPA_RVT_BRANCH:
+        res.push_back(&data.branch.cond);
+        add_slice(data.branch.true_args);
+        add_slice(data.branch.false_args);
+        break;
+    case KOOPA_RVT_JUMP:
+        add_slice(data.jump.args);
+        break;
+    case KOOPA_RVT_CALL:
+        add_slice(data.call.args);
+        break;
+    case KOOPA_RVT_RETURN:
+        if(data.ret.value)
+            res.push_back(&data.ret.value);
+        break;
+    default:
+        break;
+    }
+
+    return res;
+}
+
+// 把只被直接读写的标量局部变量提升为 SSA 值, 汇合处的值用基本块参数传递
+// 参数放在变量定值所在块的迭代支配边界上, 并且只放在变量在入口处活跃的块
+void CompUnitAST::mem2reg(koopa_raw_function_data_t *kfunc)
+{
+    int n = kfunc->bbs.len;
+    if(!n)
+        return;
+
+    std::vector<koopa_raw_basic_block_data_t *> blocks;
+    std::unordered_map<koopa_raw_basic_block_t, int> index;
+    for(int i = 0; i < n; i ++)
+    {
+        blocks.push_back((koopa_raw_basic_block_data_t *)kfunc->bbs.buffer[i]);
+        index[blocks[i]] = i;
+    }
+
+    CFG cfg(n);
+    for(int b = 0; b < n; b ++)
+    {
+        if(!blocks[b]->insts.len)
+            continue;
+        auto last = (koopa_raw_value_t)blocks[b]->insts.buffer[blocks[b]->insts.len - 1];
+        if(last->kind.tag == KOOPA_RVT_BRANCH)
+        {
+            cfg.add_edge(b, index[last->kind.data.branch.true_bb]);
+            cfg.add_edge(b, index[last->kind.data.branch.false_bb]);
+        }
+        else if(last->kind.tag == KOOPA_RVT_JUMP)
+            cfg.add_edge(b, index[last->kind.data.jump.target]);
+    }
+    cfg.analyze();
+
+    // 不可达的块直接删掉, 剩下的块中地址只作为 load 和 store 目标的标量变量可以提升
+    std::unordered_map<koopa_raw_value_t, int> vars;
+    std::vector<koopa_raw_value_t> allocs;
+    std::vector<char> promoted;
+    for(int b = 0; b < n; b ++)
+        for(int i = 0; cfg.reachable(b) && i < (int)blocks[b]->insts.len; i ++)
+        {
+            auto kval = (koopa_raw_value_t)blocks[b]->insts.buffer[i];
+            if(kval->kind.tag == KOOPA_RVT_ALLOC && kval->ty->data.pointer.base->tag != KOOPA_RTT_ARRAY)
+            {
+                vars[kval] = allocs.size();
+                allocs.push_back(kval);
+                promoted.push_back(true);
+            }
+        }
+    for(int b = 0; b < n; b ++)
+        for(int i = 0; cfg.reachable(b) && i < (int)blocks[b]->insts.len; i ++)
+        {
+            auto kval = (koopa_raw_value_t)blocks[b]->insts.buffer[i];
+            auto &data = kval->kind.data;
+            for(auto op : operands(kval))
+            {
+                auto it = vars.find(*op);
+                if(it == vars.end())
+                    continue;
+                if(kval->kind.tag == KOOPA_RVT_LOAD && op == &data.load.src)
+                    continue;
+                if(kval->kind.tag == KOOPA_RVT_STORE && op == &data.store.dest)
+                    continue;
+                promoted[it->second] = false;
+            }
+        }
+
+    // 每个块中写过的变量, 以及读之前没有写过的变量
+    int m = allocs.size();
+    std::vector<std::vector<int>> defs(m), uses(m);
+    for(int b = 0; b < n; b ++)
+    {
+        std::unordered_map<int, int> state;
+        for(int i = 0; cfg.reachable(b) && i < (int)blocks[b]->insts.len; i ++)
+        {
+            auto kval = (koopa_raw_value_t)blocks[b]->insts.buffer[i];
+            bool store = kval->kind.tag == KOOPA_RVT_STORE;
+            if(!store && kval->kind.tag != KOOPA_RVT_LOAD)
+                continue;
+            auto it = vars.find(store ? kval->kind.data.store.dest : kval->kind.data.load.src);
+            if(it == vars.end() || !promoted[it->second])
+                continue;
+            int &s = state[it->second];
+            if(!store && !s)
+                uses[it->second].push_back(b);
+            if(store && !(s & 2))
+                defs[it->second].push_back(b);
+            s |= store ? 2 : 1;
+        }
+    }
+
+    // 支配边界
+    std::vector<std::vector<int>> frontier(n), children(n);
+    for(int b = 1; b < n; b ++)
+    {
+        if(!cfg.reachable(b))
+            continue;
+        children[cfg.idom[b]].push_back(b);
+        if(cfg.pred[b].size() < 2)
+            continue;
+        for(int p : cfg.pred[b])
+            for(int runner = p; cfg.reachable(p) && runner != cfg.idom[b]; runner = cfg.idom[runner])
+                if(frontier[runner].empty() || frontier[runner].back() != b)
+                    frontier[runner].push_back(b);
+    }
+
+    std::vector<std::vector<std::pair<int, koopa_raw_value_t>>> params(n);
+    std::vector<char> live(n, false), kill(n, false), placed(n, false), queued(n, false);
+    for(int v = 0; v < m; v ++)
+    {
+        if(!promoted[v])
+            continue;
+
+        // 变量在入口处活跃的块: 从读之前没有写过的块沿前驱回溯, 遇到写过的块为止
+        std::vector<int> work = uses[v], touched = uses[v];
+        for(int b : defs[v])
+            kill[b] = true;
+        for(int b : uses[v])
+            live[b] = true;
+        while(!work.empty())
+        {
+            int b = work.back();
+            work.pop_back();
+            for(int p : cfg.pred[b])
+                if(cfg.reachable(p) && !live[p] && !kill[p])
+                {
+                    live[p] = true;
+                    touched.push_back(p);
+                    work.push_back(p);
+                }
+        }
+
+        // 在迭代支配边界上放置参数, 新的参数也是一次定值
+        auto base = allocs[v]->ty->data.pointer.base;
+        std::vector<int> placed_blocks;
+        work = defs[v];
+        for(int b : defs[v])
+            queued[b] = true;
+        while(!work.empty())
+        {
+            int b = work.back();
+            work.pop_back();
+            for(int d : frontier[b])
+            {
+                if(placed[d])
+                    continue;
+                placed[d] = true;
+                placed_blocks.push_back(d);
+                if(!queued[d])
+                {
+                    queued[d] = true;
+                    work.push_back(d);
+                }
+            }
+        }
+        for(int b : placed_blocks)
+            if(live[b])
+            {
+                auto param = context->arena.make(koopa_raw_value_data{base, string_data("%" + std::string(allocs[v]->name + 1)), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BLOCK_ARG_REF, .data.block_arg_ref.index = params[b].size()}});
+                params[b].push_back({v, param});
+            }
+
+        for(int b : touched)
+            live[b] = false;
+        for(int b : defs[v])
+            kill[b] = queued[b] = false;
+        for(int b : placed_blocks)
+            placed[b] = queued[b] = false;
+    }
+
+    // 沿支配树先序改名: 每个变量维护当前值的栈, 去掉提升的 alloc, load 和 store, load 的结果换成当前值
+    // 没有写过就读的变量的值是 undef
+    std::vector<std::vector<koopa_raw_value_t>> values(m);
+    std::vector<koopa_raw_value_t> undefs(m, nullptr);
+    std::vector<std::vector<int>> pushed(n);
+    std::unordered_map<koopa_raw_value_t, koopa_raw_value_t> replace;
+    auto current = [&](int v)
+    {
+        if(!values[v].empty())
+            return values[v].back();
+        if(!undefs[v])
+            undefs[v] = context->arena.make(koopa_raw_value_data{allocs[v]->ty->data.pointer.base, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_UNDEF}});
+        return undefs[v];
+    };
+    auto block_args = [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &args)
+    {
+        std::vector<void *> res;
+        for(auto &[v, param] : params[index[target]])
+            res.push_back((void *)current(v));
+        if(!res.empty())
+            args = {vector_data(res), (unsigned)res.size(), KOOPA_RSIK_VALUE};
+    };
+
+    std::vector<std::pair<int, bool>> stack = {{0, false}};
+    while(!stack.empty())
+    {
+        auto [b, done] = stack.back();
+        stack.pop_back();
+        if(done)
+        {
+            for(int v : pushed[b])
+                values[v].pop_back();
+            continue;
+        }
+        stack.push_back({b, true});
+
+        for(auto &[v, param] : params[b])
+        {
+            values[v].push_back(param);
+            pushed[b].push_back(v);
+        }
+        std::vector<void *> insts;
+        for(int i = 0; i < (int)blocks[b]->insts.len; i ++)
+        {
+            auto kval = (koopa_raw_value_t)blocks[b]->insts.buffer[i];
+            for(auto op : operands(kval))
+            {
+                auto it = replace.find(*op);
+                if(it != replace.end())
+                    *op = it->second;
+            }
+
+            auto &data = ((koopa_raw_value_data *)kval)->kind.data;
+            auto it = vars.end();
+            if(kval->kind.tag == KOOPA_RVT_ALLOC)
+                it = vars.find(kval);
+            else if(kval->kind.tag == KOOPA_RVT_LOAD)
+                it = vars.find(data.load.src);
+            else if(kval->kind.tag == KOOPA_RVT_STORE)
+                it = vars.find(data.store.dest);
+            if(it == vars.end() || !promoted[it->second])
+            {
+                if(kval->kind.tag == KOOPA_RVT_BRANCH)
+                {
+                    block_args(data.branch.true_bb, data.branch.true_args);
+                    block_args(data.branch.false_bb, data.branch.false_args);
+                }
+                else if(kval->kind.tag == KOOPA_RVT_JUMP)
+                    block_args(data.jump.target, data.jump.args);
+                insts.push_back((void *)kval);
+            }
+            else if(kval->kind.tag == KOOPA_RVT_LOAD)
+                replace[kval] = current(it->second);
+            else if(kval->kind.tag == KOOPA_RVT_STORE)
+            {
+                values[it->second].push_back(data.store.value);
+                pushed[b].push_back(it->second);
+            }
+        }
+        blocks[b]->insts = {vector_data(insts), (unsigned)insts.size(), KOOPA_RSIK_VALUE};
+
+        for(int i = children[b].size() - 1; i >= 0; i --)
+            stack.push_back({children[b][i], false});
+    }
+
+    std::vector<void *> reachable;
+    for(int b = 0; b < n; b ++)
+    {
+        if(!cfg.reachable(b))
+            continue;
+        std::vector<void *> args;
+        for(auto &[v, param] : params[b])
+            args.push_back((void *)param);
+        blocks[b]->params = {vector_data(args), (unsigned)args.size(), KOOPA_RSIK_VALUE};
+        reachable.push_back(blocks[b]);
+    }
+    kfunc->bbs = {vector_data(reachable), (unsigned)reachable.size(), KOOPA_RSIK_BASIC_BLOCK};
+
+    return;
+}
+
 CompUnitAST::CompUnitAST(std::vector<std::unique_ptr<BaseAST>> &_func_vec, std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>> &_value_vec)
 {
     for(auto &func : _func_vec)
@@ -68,7 +549,7 @@ koopa_raw_program_t CompUnitAST::to_koopa_program(void)
 {
     std::vector<void *> funcs, values;
 
-    symbol_list.new_scope();
+    context->symbol_list.new_scope();
     libfuncs(funcs);
     for(auto &value : value_vec)
     {
@@ -80,8 +561,13 @@ koopa_raw_program_t CompUnitAST::to_koopa_program(void)
             values.push_back(value.second->to_koopa());
     }
     for(auto &func : func_vec)
+    {
         funcs.push_back(func->to_koopa());
-    symbol_list.end_scope();
+        tail_recursion((koopa_raw_function_data_t *)funcs.back());
+        mem2reg((koopa_raw_function_data_t *)funcs.back());
+    }
+    context->symbol_list.end_scope();
+    link_used_by(funcs);
 
     return {{vector_data(values), (unsigned)values.size(), KOOPA_RSIK_VALUE}, {vector_data(funcs), (unsigned)funcs.size(), KOOPA_RSIK_FUNCTION}};
 }
@@ -94,9 +580,9 @@ FuncTypeAST::FuncTypeAST(std::string _ident) : ident(_ident)
 void *FuncTypeAST::to_koopa(void)
 {
     if(ident == "int")
-        return new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32};
+        return (void *)context->type_table.int32();
     else if(ident == "void")
-        return new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT};
+        return (void *)context->type_table.unit();
     throw std::runtime_error("error: FuncType is " + ident + " but not int/void");
 }
 
@@ -113,21 +599,21 @@ FuncFParamAST::FuncFParamAST(ParamType _type, std::string _ident, int _index, st
    return;
 }
 
-koopa_raw_type_kind *FuncFParamAST::get_type(void)
+koopa_raw_type_t FuncFParamAST::get_type(void)
 {
     if(type == INT)
-        return new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32};
+        return context->type_table.int32();
     else if(type == ARRAY)
     {
         if(sz_exp.empty())
-            return new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}};
+            return context->type_table.pointer(context->type_table.int32());
         else
         {
             std::vector<int> sz;
             for(auto &exp : sz_exp)
                 sz.push_back(exp->value());
 
-            return new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = array_data(sz, 0)};
+            return context->type_table.pointer(array_data(sz, 0));
         }
     }
 
@@ -136,7 +622,7 @@ koopa_raw_type_kind *FuncFParamAST::get_type(void)
 
 void *FuncFParamAST::to_koopa(void)
 {
-    return new koopa_raw_value_data{get_type(), string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_FUNC_ARG_REF, .data.func_arg_ref.index = (unsigned)index}};
+    return context->arena.make(koopa_raw_value_data{get_type(), string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_FUNC_ARG_REF, .data.func_arg_ref.index = (unsigned)index}});
 }
 
 FuncDefAST::FuncDefAST(std::unique_ptr<BaseAST> &_func_type, std::string _ident, std::vector<std::unique_ptr<BaseAST>> &_fparams, std::unique_ptr<BaseAST> &_block) : ident(_ident)
@@ -151,41 +637,41 @@ FuncDefAST::FuncDefAST(std::unique_ptr<BaseAST> &_func_type, std::string _ident,
 
 void *FuncDefAST::to_koopa(void)
 {
+    std::vector<koopa_raw_type_t> types;
     std::vector<void *> params, blocks;
 
     for(auto &fparam : fparams)
-        params.push_back(((FuncFParamAST *)fparam.get())->get_type());
-    koopa_raw_type_kind_t *ty = new koopa_raw_type_kind_t{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {vector_data(params), (unsigned)params.size(), KOOPA_RSIK_TYPE}, .data.function.ret = (const struct koopa_raw_type_kind *)func_type->to_koopa()};
+        types.push_back(((FuncFParamAST *)fparam.get())->get_type());
+    koopa_raw_type_t ty = context->type_table.function(types, (koopa_raw_type_t)func_type->to_koopa());
 
-    params.clear();
     for(auto &fparam : fparams)
         params.push_back(fparam->to_koopa());
-    koopa_raw_function_data_t *res = new koopa_raw_function_data_t{ty, string_data("@" + ident), {vector_data(params), (unsigned)params.size(), KOOPA_RSIK_VALUE}, {}};
+    koopa_raw_function_data_t *res = context->arena.make(koopa_raw_function_data_t{ty, string_data("@" + ident), {vector_data(params), (unsigned)params.size(), KOOPA_RSIK_VALUE}, {}});
 
-    koopa_raw_basic_block_data_t *entry = new koopa_raw_basic_block_data_t{string_data("%entry_" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-    symbol_list.add_symbol(ident, {LVal::FUNCTION, res});
-    symbol_list.new_scope();
-    block_inst.set_block(&blocks);
-    block_inst.new_block(entry);
+    koopa_raw_basic_block_data_t *entry = context->arena.make(koopa_raw_basic_block_data_t{string_data("%entry_" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+    context->symbol_list.add_symbol(ident, {LVal::FUNCTION, res});
+    context->symbol_list.new_scope();
+    context->block_inst.set_block(&blocks);
+    context->block_inst.new_block(entry);
 
     for(int i = 0; i < (int)fparams.size(); i++)
     {
         FuncFParamAST *fp = (FuncFParamAST *)fparams[i].get();
-        koopa_raw_value_data *allo = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = ((koopa_raw_value_t)params[i])->ty}, string_data("@" + fp->ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ALLOC}};
-        symbol_list.add_symbol(fp->ident, {allo->ty->data.pointer.base->tag == KOOPA_RTT_POINTER ? LVal::POINTER : LVal::VAR, allo});
-        block_inst.add_inst(allo);
-        block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_STORE, .data.store.value = (koopa_raw_value_t)params[i], .data.store.dest = allo}});
+        koopa_raw_value_data *allo = context->arena.make(koopa_raw_value_data{context->type_table.pointer(((koopa_raw_value_t)params[i])->ty), string_data("@" + fp->ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ALLOC}});
+        context->symbol_list.add_symbol(fp->ident, {allo->ty->data.pointer.base->tag == KOOPA_RTT_POINTER ? LVal::POINTER : LVal::VAR, allo});
+        context->block_inst.add_inst(allo);
+        context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_STORE, .data.store.value = (koopa_raw_value_t)params[i], .data.store.dest = allo}}));
     }
     for(auto &inst : ((BlockAST *)block.get())->insts)
         inst.second->to_koopa();
     if(((BlockAST *)block.get())->insts.empty() || typeid((((BlockAST *)block.get())->insts).back()) != typeid(ReturnAST))
     {
         auto zero = std::unique_ptr<BaseAST>(new NumberAST(0));
-        (((koopa_raw_type_kind *)func_type->to_koopa())->tag == KOOPA_RTT_UNIT ? ReturnAST() : ReturnAST(zero)).to_koopa();
+        (((koopa_raw_type_t)func_type->to_koopa())->tag == KOOPA_RTT_UNIT ? ReturnAST() : ReturnAST(zero)).to_koopa();
     }
 
-    block_inst.end_block();
-    symbol_list.end_scope();
+    context->block_inst.end_block();
+    context->symbol_list.end_scope();
 
     res->bbs = {vector_data(blocks), (unsigned)blocks.size(), KOOPA_RSIK_BASIC_BLOCK};
 
@@ -202,10 +688,10 @@ BlockAST::BlockAST(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>> &_
 
 void *BlockAST::to_koopa(void)
 {
-    symbol_list.new_scope();
+    context->symbol_list.new_scope();
     for(auto &inst : insts)
         inst.second->to_koopa();
-    symbol_list.end_scope();
+    context->symbol_list.end_scope();
 
     return nullptr;
 }
@@ -224,11 +710,11 @@ ReturnAST::ReturnAST(std::unique_ptr<BaseAST> &_ret_val)
 
 void *ReturnAST::to_koopa(void)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_RETURN}};
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_RETURN}});
 
     if(ret_val)
         res->kind.data.ret.value = (const koopa_raw_value_data *)ret_val->to_koopa();
-    block_inst.add_inst(res);
+    context->block_inst.add_inst(res);
 
     return res;
 }
@@ -243,9 +729,9 @@ AssignmentAST::AssignmentAST(std::unique_ptr<BaseAST> &_lval, std::unique_ptr<Ba
 
 void *AssignmentAST::to_koopa(void)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_STORE, .data.store.value = (koopa_raw_value_t)exp->to_koopa(), .data.store.dest = (koopa_raw_value_t)((LValAST *)lval.get())->left_value()}};
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_STORE, .data.store.value = (koopa_raw_value_t)exp->to_koopa(), .data.store.dest = (koopa_raw_value_t)((LValAST *)lval.get())->left_value()}});
 
-    block_inst.add_inst(res);
+    context->block_inst.add_inst(res);
 
     return nullptr;
 }
@@ -272,28 +758,28 @@ BranchAST::BranchAST(std::unique_ptr<BaseAST> &_exp, std::vector<std::pair<InstT
 
 void *BranchAST::to_koopa(void)
 {
-    koopa_raw_basic_block_data_t *true_block = new koopa_raw_basic_block_data_t{"%true", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-    koopa_raw_basic_block_data_t *false_block = new koopa_raw_basic_block_data_t{"%false", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-    koopa_raw_basic_block_data_t *end_block = new koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = (koopa_raw_value_t)exp->to_koopa(), .data.branch.true_bb = true_block, .data.branch.false_bb = false_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}};
+    koopa_raw_basic_block_data_t *true_block = context->arena.make(koopa_raw_basic_block_data_t{"%true", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+    koopa_raw_basic_block_data_t *false_block = context->arena.make(koopa_raw_basic_block_data_t{"%false", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+    koopa_raw_basic_block_data_t *end_block = context->arena.make(koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = (koopa_raw_value_t)exp->to_koopa(), .data.branch.true_bb = true_block, .data.branch.false_bb = false_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}});
 
-    block_inst.add_inst(res);
+    context->block_inst.add_inst(res);
 
-    block_inst.new_block(true_block);
-    symbol_list.new_scope();
+    context->block_inst.new_block(true_block);
+    context->symbol_list.new_scope();
     for(auto &inst : true_insts)
         inst.second->to_koopa();
-    symbol_list.end_scope();
-    block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}});
+    context->symbol_list.end_scope();
+    context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}}));
 
-    block_inst.new_block(false_block);
-    symbol_list.new_scope();
+    context->block_inst.new_block(false_block);
+    context->symbol_list.new_scope();
     for(auto &inst : false_insts)
         inst.second->to_koopa();
-    symbol_list.end_scope();
-    block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}});
+    context->symbol_list.end_scope();
+    context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}}));
 
-    block_inst.new_block(end_block);
+    context->block_inst.new_block(end_block);
 
     return nullptr;
 }
@@ -310,39 +796,39 @@ WhileAST::WhileAST(std::unique_ptr<BaseAST> &_exp, std::vector<std::pair<InstTyp
 
 void *WhileAST::to_koopa(void)
 {
-    koopa_raw_basic_block_data_t *while_entry = new koopa_raw_basic_block_data_t{"%while_entry", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-    koopa_raw_basic_block_data_t *while_body = new koopa_raw_basic_block_data_t{"%while_body", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-    koopa_raw_basic_block_data_t *end_block = new koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
+    koopa_raw_basic_block_data_t *while_entry = context->arena.make(koopa_raw_basic_block_data_t{"%while_entry", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+    koopa_raw_basic_block_data_t *while_body = context->arena.make(koopa_raw_basic_block_data_t{"%while_body", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+    koopa_raw_basic_block_data_t *end_block = context->arena.make(koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
 
-    loop_inst.push_back(std::make_tuple(while_entry, while_body, end_block));
-    block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = while_entry}});
-    block_inst.new_block(while_entry);
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = (koopa_raw_value_t)exp->to_koopa(), .data.branch.true_bb = while_body, .data.branch.false_bb = end_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}};
-    block_inst.add_inst(res);
+    context->loop_inst.push_back(std::make_tuple(while_entry, while_body, end_block));
+    context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = while_entry}}));
+    context->block_inst.new_block(while_entry);
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = (koopa_raw_value_t)exp->to_koopa(), .data.branch.true_bb = while_body, .data.branch.false_bb = end_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}});
+    context->block_inst.add_inst(res);
 
-    block_inst.new_block(while_body);
-    symbol_list.new_scope();
+    context->block_inst.new_block(while_body);
+    context->symbol_list.new_scope();
     for(auto &inst : body_insts)
         inst.second->to_koopa();
-    symbol_list.end_scope();
-    block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = while_entry}});
+    context->symbol_list.end_scope();
+    context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = while_entry}}));
 
-    block_inst.new_block(end_block);
-    loop_inst.pop_back();
+    context->block_inst.new_block(end_block);
+    context->loop_inst.pop_back();
 
     return nullptr;
 }
 
 void *BreakAST::to_koopa(void)
 {
-    block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = std::get<2>(loop_inst.back())}});
+    context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = std::get<2>(context->loop_inst.back())}}));
 
     return nullptr;
 }
 
 void *ContinueAST::to_koopa(void)
 {
-    block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = std::get<0>(loop_inst.back())}});
+    context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = std::get<0>(context->loop_inst.back())}}));
 
     return nullptr;
 }
@@ -356,11 +842,11 @@ ConstDefAST::ConstDefAST(std::string _ident, std::unique_ptr<BaseAST> &_exp) : i
 
 void *ConstDefAST::to_koopa(void)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = exp->value()}};
+    koopa_raw_value_t res = context->const_pool.integer(exp->value());
 
-    symbol_list.add_symbol(ident, LVal{LVal::CONST, res});
+    context->symbol_list.add_symbol(ident, LVal{LVal::CONST, (void *)res});
 
-    return res;
+    return (void *)res;
 }
 
 
@@ -380,15 +866,15 @@ VarDefAST::VarDefAST(std::string _ident, std::unique_ptr<BaseAST> &_exp) : ident
 
 void *VarDefAST::to_koopa(void)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}, string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ALLOC}};
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.pointer(context->type_table.int32()), string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ALLOC}});
 
-    block_inst.add_inst(res);
-    symbol_list.add_symbol(ident, LVal{LVal::VAR, res});
+    context->block_inst.add_inst(res);
+    context->symbol_list.add_symbol(ident, LVal{LVal::VAR, res});
 
     if(exp)
     {
-        koopa_raw_value_data *store = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = res, .data.store.value = (koopa_raw_value_t)exp->to_koopa()}};
-        block_inst.add_inst(store);
+        koopa_raw_value_data *store = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = res, .data.store.value = (koopa_raw_value_t)exp->to_koopa()}});
+        context->block_inst.add_inst(store);
     }
 
     return res;
@@ -405,10 +891,10 @@ GlobalVarDefAST::GlobalVarDefAST(std::unique_ptr<BaseAST> &vardef_ast)
 
 void *GlobalVarDefAST::to_koopa(void)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}, string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GLOBAL_ALLOC, .data.global_alloc.init = exp ? new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = exp->value()}} : new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ZERO_INIT}}}};
+    koopa_raw_value_data *res = context->arena.make(koopa_raw_value_data{context->type_table.pointer(context->type_table.int32()), string_data("@" + ident), {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GLOBAL_ALLOC, .data.global_alloc.init = exp ? context->const_pool.integer(exp->value()) : context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_ZERO_INIT}})}});
 
-    block_inst.add_inst(res);
-    symbol_list.add_symbol(ident, {LVal::VAR, res});
+    context->block_inst.add_inst(res);
+    context->symbol_list.add_symbol(ident, {LVal::VAR, res});
 
     return res;
 }
@@ -23,6 +23,7 @@ int ExpAST::value(void)
 
 LValAST::LValAST(std::string _ident) : ident(_ident)
 {
+    id = context->symbol_list.intern(ident);
     type = NUM;
 
     return;
@@ -30,6 +31,7 @@ LValAST::LValAST(std::string _ident) : ident(_ident)
 
 LValAST::LValAST(std::string _ident, std::vector<std::unique_ptr<BaseAST>> &_idx_vec) : ident(_ident)
 {
+    id = context->symbol_list.intern(ident);
     type = ARRAY;
     for(auto &idx : _idx_vec)
         idx_vec.push_back(std::move(idx));
@@ -40,33 +42,33 @@ LValAST::LValAST(std::string _ident, std::vector<std::unique_ptr<BaseAST>> &_idx
 void *LValAST::left_value(void)
 {
     if(type == NUM)
-        return symbol_list.get_symbol(ident).number;
+        return context->symbol_list.get_symbol(id).number;
 
     koopa_raw_value_data *get;
-    koopa_raw_value_t src = (koopa_raw_value_t)symbol_list.get_symbol(ident).number;
+    koopa_raw_value_t src = (koopa_raw_value_t)context->symbol_list.get_symbol(id).number;
 
     if(src->ty->data.pointer.base->tag == KOOPA_RTT_POINTER)
     {
-        koopa_raw_value_t src = (koopa_raw_value_t)symbol_list.get_symbol(ident).number;
-        koopa_raw_value_data *load0 = new koopa_raw_value_data{src->ty->data.pointer.base, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = src}};
-        block_inst.add_inst(load0);
+        koopa_raw_value_t src = (koopa_raw_value_t)context->symbol_list.get_symbol(id).number;
+        koopa_raw_value_data *load0 = context->arena.make(koopa_raw_value_data{src->ty->data.pointer.base, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = src}});
+        context->block_inst.add_inst(load0);
 
         src = load0;
         for(auto &idx : idx_vec)
         {
             if(&idx == idx_vec.data())
-                get = new koopa_raw_value_data{src->ty, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_PTR, .data.get_ptr.src = src, .data.get_ptr.index = (koopa_raw_value_t)idx->to_koopa()}};
+                get = context->arena.make(koopa_raw_value_data{src->ty, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_PTR, .data.get_ptr.src = src, .data.get_ptr.index = (koopa_raw_value_t)idx->to_koopa()}});
             else
-                get = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}};
-            block_inst.add_inst(get);
+                get = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}});
+            context->block_inst.add_inst(get);
             src = get;
         }
     }
     else
         for(auto &idx : idx_vec)
         {
-            get = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}};
-            block_inst.add_inst(get);
+            get = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}});
+            context->block_inst.add_inst(get);
             src = get;
         }
 
@@ -75,15 +77,15 @@ void *LValAST::left_value(void)
 
 void *LValAST::to_koopa(void)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data();
+    koopa_raw_value_data *res = nullptr;
 
-    auto var = symbol_list.get_symbol(ident);
+    auto var = context->symbol_list.get_symbol(id);
     if(var.type == LVal::CONST)
         return (void *)var.number;
     else if(var.type == LVal::VAR)
     {
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = (koopa_raw_value_t)var.number}};
-        block_inst.add_inst(res);
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = (koopa_raw_value_t)var.number}});
+        context->block_inst.add_inst(res);
     }
     else if(var.type == LVal::ARRAY)
     {
@@ -93,28 +95,28 @@ void *LValAST::to_koopa(void)
 
         if(idx_vec.empty())
         {
-            get = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = 0}}}};
-            block_inst.add_inst(get);
+            get = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = context->const_pool.integer(0)}});
+            context->block_inst.add_inst(get);
         }
         else
             for(auto &idx : idx_vec)
             {
                 if(src->ty->data.pointer.base->data.array.base->tag == KOOPA_RTT_INT32)
                     load = true;
-                get = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}};
-                block_inst.add_inst(get);
+                get = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}});
+                context->block_inst.add_inst(get);
                 src = get;
             }
         
         if(load)
         {
-            res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = get}};
-            block_inst.add_inst(res);
+            res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = get}});
+            context->block_inst.add_inst(res);
         }
         else if(src->ty->data.pointer.base->tag == KOOPA_RTT_ARRAY)
         {
-            res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = 0}}}};
-            block_inst.add_inst(res);
+            res = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = context->const_pool.integer(0)}});
+            context->block_inst.add_inst(res);
         }
         else
             res = src;
@@ -125,17 +127,17 @@ void *LValAST::to_koopa(void)
         koopa_raw_value_data *get;
         koopa_raw_value_data *src = (koopa_raw_value_data*)var.number;
 
-        koopa_raw_value_data *load0 = new koopa_raw_value_data{src->ty->data.pointer.base, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = src}};
-        block_inst.add_inst(load0);
+        koopa_raw_value_data *load0 = context->arena.make(koopa_raw_value_data{src->ty->data.pointer.base, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = src}});
+        context->block_inst.add_inst(load0);
 
         src = load0;
         for(auto &idx : idx_vec)
         {
             if(&idx == idx_vec.data())
-                get = new koopa_raw_value_data{src->ty, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_PTR, .data.get_ptr.src = src, .data.get_ptr.index = (koopa_raw_value_t)idx->to_koopa()}};
+                get = context->arena.make(koopa_raw_value_data{src->ty, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_PTR, .data.get_ptr.src = src, .data.get_ptr.index = (koopa_raw_value_t)idx->to_koopa()}});
             else
-                get = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}};
-            block_inst.add_inst(get);
+                get = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = (koopa_raw_value_t)idx->to_koopa()}});
+            context->block_inst.add_inst(get);
 
             src = get;
             if(get->ty->data.pointer.base->tag == KOOPA_RTT_INT32)
@@ -144,13 +146,13 @@ void *LValAST::to_koopa(void)
 
         if(load)
         {
-            res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = get}};
-            block_inst.add_inst(res);
+            res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = get}});
+            context->block_inst.add_inst(res);
         }
         else if(src->ty->data.pointer.base->tag == KOOPA_RTT_ARRAY)
         {
-            res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = src->ty->data.pointer.base->data.array.base}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = 0}}}};
-            block_inst.add_inst(res);
+            res = context->arena.make(koopa_raw_value_data{context->type_table.pointer(src->ty->data.pointer.base->data.array.base), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_GET_ELEM_PTR, .data.get_elem_ptr.src = src, .data.get_elem_ptr.index = context->const_pool.integer(0)}});
+            context->block_inst.add_inst(res);
         }
         else
             res = src;
@@ -161,7 +163,7 @@ void *LValAST::to_koopa(void)
 
 int LValAST::value(void)
 {
-    auto var = symbol_list.get_symbol(ident);
+    auto var = context->symbol_list.get_symbol(id);
 
     if(var.type != LVal::CONST)
         throw std::runtime_error("error: LValAST must be LVal::CONST in symbol table");
@@ -194,7 +196,7 @@ UnaryExpAST::UnaryExpAST(std::unique_ptr<BaseAST> &_primary_exp)
     return;
 }
 
-UnaryExpAST::UnaryExpAST(std::string _op, std::unique_ptr<BaseAST> &_unary_exp) : op(_op)
+UnaryExpAST::UnaryExpAST(OpType _op, std::unique_ptr<BaseAST> &_unary_exp) : op(_op)
 {
     type = OP;
     next_exp = std::move(_unary_exp);
@@ -202,7 +204,7 @@ UnaryExpAST::UnaryExpAST(std::string _op, std::unique_ptr<BaseAST> &_unary_exp)
     return;
 }
 
-UnaryExpAST::UnaryExpAST(std::string _ident, std::vector<std::unique_ptr<BaseAST>> &_rparams) : op(_ident)
+UnaryExpAST::UnaryExpAST(std::string _ident, std::vector<std::unique_ptr<BaseAST>> &_rparams) : ident(_ident)
 {
     type = FUNCTION;
     for(auto &rparam : _rparams)
@@ -220,30 +222,30 @@ void *UnaryExpAST::to_koopa(void)
     switch(type)
     {
     case FUNCTION:
-        func = (koopa_raw_function_data_t *)symbol_list.get_symbol(op).number;
+        func = (koopa_raw_function_data_t *)context->symbol_list.get_symbol(ident).number;
         for(auto &rparam : rparams)
             params.push_back(rparam->to_koopa());
-        res = new koopa_raw_value_data{func->ty->data.function.ret, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_CALL, .data.call.callee = func, .data.call.args = {vector_data(params), (unsigned)params.size(), KOOPA_RSIK_VALUE}}};
+        res = context->arena.make(koopa_raw_value_data{func->ty->data.function.ret, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_CALL, .data.call.callee = func, .data.call.args = {vector_data(params), (unsigned)params.size(), KOOPA_RSIK_VALUE}}});
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     case PRIMARY:
         res = (koopa_raw_value_data *)next_exp->to_koopa();
         break;
     case OP:
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}};
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}});
 
         auto &binary = res->kind.data.binary;
-        if(op == "+")
+        if(op == OP_ADD)
             binary.op = KOOPA_RBO_ADD;
-        else if(op == "-")
+        else if(op == OP_SUB)
             binary.op = KOOPA_RBO_SUB;
-        else if(op == "!")
+        else if(op == OP_NOT)
             binary.op = KOOPA_RBO_EQ;
-        binary.lhs = (koopa_raw_value_t)NumberAST(0).to_koopa();
+        binary.lhs = context->const_pool.integer(0);
         binary.rhs = (koopa_raw_value_t)next_exp->to_koopa();
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     }
 
@@ -256,11 +258,11 @@ int UnaryExpAST::value(void)
         return next_exp->value();
 
     int res = 0;
-    if(op == "+")
+    if(op == OP_ADD)
         res = next_exp->value();
-    else if(op == "-")
+    else if(op == OP_SUB)
         res = -next_exp->value();
-    else if(op == "!")
+    else if(op == OP_NOT)
         res = !next_exp->value();
 
     return res;
@@ -273,7 +275,7 @@ MulExpAST::MulExpAST(std::unique_ptr<BaseAST> &_primary_exp)
 
     return;
 }
-MulExpAST::MulExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
+MulExpAST::MulExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
 {
     type = OP;
     left_exp = std::move(_left_exp);
@@ -292,19 +294,19 @@ void *MulExpAST::to_koopa(void)
         res = (koopa_raw_value_data *)left_exp->to_koopa();
         break;
     case OP:
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}};
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}});
 
         auto &binary = res->kind.data.binary;
-        if(op == "*")
+        if(op == OP_MUL)
             binary.op = KOOPA_RBO_MUL;
-        else if(op == "/")
+        else if(op == OP_DIV)
             binary.op = KOOPA_RBO_DIV;
-        else if(op == "%")
+        else if(op == OP_MOD)
             binary.op = KOOPA_RBO_MOD;
         binary.lhs = (koopa_raw_value_t)left_exp->to_koopa();
         binary.rhs = (koopa_raw_value_t)right_exp->to_koopa();
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     }
 
@@ -317,11 +319,11 @@ int MulExpAST::value(void)
         return left_exp->value();
 
     int res = 0;
-    if(op == "*")
+    if(op == OP_MUL)
         res = left_exp->value() * right_exp->value();
-    else if(op == "/")
+    else if(op == OP_DIV)
         res = left_exp->value() / right_exp->value();
-    else if(op == "%")
+    else if(op == OP_MOD)
         res = left_exp->value() % right_exp->value();
 
     return res;
@@ -334,7 +336,7 @@ AddExpAST::AddExpAST(std::unique_ptr<BaseAST> &_primary_exp)
 
     return;
 }
-AddExpAST::AddExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
+AddExpAST::AddExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
 {
     type = OP;
     left_exp = std::move(_left_exp);
@@ -353,17 +355,17 @@ void *AddExpAST::to_koopa(void)
         res = (koopa_raw_value_data *)left_exp->to_koopa();
         break;
     case OP:
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}};
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}});
 
         auto &binary = res->kind.data.binary;
-        if(op == "+")
+        if(op == OP_ADD)
             binary.op = KOOPA_RBO_ADD;
-        else if(op == "-")
+        else if(op == OP_SUB)
             binary.op = KOOPA_RBO_SUB;
         binary.lhs = (koopa_raw_value_t)left_exp->to_koopa();
         binary.rhs = (koopa_raw_value_t)right_exp->to_koopa();
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     }
 
@@ -376,9 +378,9 @@ int AddExpAST::value(void)
         return left_exp->value();
 
     int res = 0;
-    if(op == "+")
+    if(op == OP_ADD)
         res = left_exp->value() + right_exp->value();
-    else if(op == "-")
+    else if(op == OP_SUB)
         res = left_exp->value() - right_exp->value();
 
     return res;
@@ -391,7 +393,7 @@ RelExpAST::RelExpAST(std::unique_ptr<BaseAST> &_primary_exp)
 
     return;
 }
-RelExpAST::RelExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
+RelExpAST::RelExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
 {
     type = OP;
     left_exp = std::move(_left_exp);
@@ -410,21 +412,21 @@ void *RelExpAST::to_koopa(void)
         res = (koopa_raw_value_data *)left_exp->to_koopa();
         break;
     case OP:
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}};
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}});
 
         auto &binary = res->kind.data.binary;
-        if(op == "<")
+        if(op == OP_LT)
             binary.op = KOOPA_RBO_LT;
-        else if(op == "<=")
+        else if(op == OP_LE)
             binary.op = KOOPA_RBO_LE;
-        else if(op == ">")
+        else if(op == OP_GT)
             binary.op = KOOPA_RBO_GT;
-        else if(op == ">=")
+        else if(op == OP_GE)
             binary.op = KOOPA_RBO_GE;
         binary.lhs = (koopa_raw_value_t)left_exp->to_koopa();
         binary.rhs = (koopa_raw_value_t)right_exp->to_koopa();
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     }
 
@@ -437,13 +439,13 @@ int RelExpAST::value(void)
         return left_exp->value();
 
     int res = 0;
-    if(op == "<")
+    if(op == OP_LT)
         res = left_exp->value() < right_exp->value();
-    else if(op == "<=")
+    else if(op == OP_LE)
         res = left_exp->value() <= right_exp->value();
-    else if(op == ">")
+    else if(op == OP_GT)
         res = left_exp->value() > right_exp->value();
-    else if(op == ">=")
+    else if(op == OP_GE)
         res = left_exp->value() >= right_exp->value();
 
     return res;
@@ -456,7 +458,7 @@ EqExpAST::EqExpAST(std::unique_ptr<BaseAST> &_primary_exp)
 
     return;
 }
-EqExpAST::EqExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
+EqExpAST::EqExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
 {
     type = OP;
     left_exp = std::move(_left_exp);
@@ -475,17 +477,17 @@ void *EqExpAST::to_koopa(void)
         res = (koopa_raw_value_data *)left_exp->to_koopa();
         break;
     case OP:
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}};
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}});
 
         auto &binary = res->kind.data.binary;
-        if(op == "==")
+        if(op == OP_EQ)
             binary.op = KOOPA_RBO_EQ;
-        else if(op == "!=")
+        else if(op == OP_NE)
             binary.op = KOOPA_RBO_NOT_EQ;
         binary.lhs = (koopa_raw_value_t)left_exp->to_koopa();
         binary.rhs = (koopa_raw_value_t)right_exp->to_koopa();
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     }
 
@@ -498,9 +500,9 @@ int EqExpAST::value(void)
         return left_exp->value();
 
     int res = 0;
-    if(op == "==")
+    if(op == OP_EQ)
         res = left_exp->value() == right_exp->value();
-    else if(op == "!=")
+    else if(op == OP_NE)
         res = left_exp->value() != right_exp->value();
 
     return res;
@@ -508,12 +510,12 @@ int EqExpAST::value(void)
 
 static koopa_raw_value_data *to_bool(BlockInst *block_inst, koopa_raw_value_t exp, int op)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}};
+    koopa_raw_value_data *res = BaseAST::context->arena.make(koopa_raw_value_data{BaseAST::context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BINARY}});
 
     auto &binary = res->kind.data.binary;
     binary.op = op;
     binary.lhs = exp;
-    binary.rhs = (koopa_raw_value_t)NumberAST(0).to_koopa();
+    binary.rhs = BaseAST::context->const_pool.integer(0);
 
     block_inst->add_inst(res);
     return res;
@@ -526,7 +528,7 @@ LAndExpAST::LAndExpAST(std::unique_ptr<BaseAST> &_primary_exp)
 
     return;
 }
-LAndExpAST::LAndExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
+LAndExpAST::LAndExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
 {
     type = OP;
     left_exp = std::move(_left_exp);
@@ -545,25 +547,25 @@ void *LAndExpAST::to_koopa(void)
         res = (koopa_raw_value_data *)left_exp->to_koopa();
         break;
     case OP:
-        koopa_raw_value_data *temp_var = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}, "%temp", {nullptr, 0, KOOPA_RSIK_TYPE}, {.tag = KOOPA_RVT_ALLOC}};
-        koopa_raw_value_data *temp_store = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = (koopa_raw_value_t)NumberAST(0).to_koopa()}};
-        block_inst.add_inst(temp_var);
-        block_inst.add_inst(temp_store);
+        koopa_raw_value_data *temp_var = context->arena.make(koopa_raw_value_data{context->type_table.pointer(context->type_table.int32()), "%temp", {nullptr, 0, KOOPA_RSIK_TYPE}, {.tag = KOOPA_RVT_ALLOC}});
+        koopa_raw_value_data *temp_store = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = context->const_pool.integer(0)}});
+        context->block_inst.add_inst(temp_var);
+        context->block_inst.add_inst(temp_store);
 
-        koopa_raw_basic_block_data_t *true_block = new koopa_raw_basic_block_data_t{"%true", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-        koopa_raw_basic_block_data_t *end_block = new koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-        koopa_raw_value_data *branch = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = to_bool(&block_inst, (koopa_raw_value_t)left_exp->to_koopa(), KOOPA_RBO_NOT_EQ), .data.branch.true_bb = true_block, .data.branch.false_bb = end_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}};
-        block_inst.add_inst(branch);
+        koopa_raw_basic_block_data_t *true_block = context->arena.make(koopa_raw_basic_block_data_t{"%true", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+        koopa_raw_basic_block_data_t *end_block = context->arena.make(koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+        koopa_raw_value_data *branch = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = to_bool(&context->block_inst, (koopa_raw_value_t)left_exp->to_koopa(), KOOPA_RBO_NOT_EQ), .data.branch.true_bb = true_block, .data.branch.false_bb = end_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}});
+        context->block_inst.add_inst(branch);
 
-        block_inst.new_block(true_block);
-        koopa_raw_value_data *right_store = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = to_bool(&block_inst, (koopa_raw_value_t)right_exp->to_koopa(), KOOPA_RBO_NOT_EQ)}};
-        block_inst.add_inst(right_store);
-        block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}});
+        context->block_inst.new_block(true_block);
+        koopa_raw_value_data *right_store = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = to_bool(&context->block_inst, (koopa_raw_value_t)right_exp->to_koopa(), KOOPA_RBO_NOT_EQ)}});
+        context->block_inst.add_inst(right_store);
+        context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}}));
 
-        block_inst.new_block(end_block);
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = temp_var}};
+        context->block_inst.new_block(end_block);
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = temp_var}});
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     }
 
@@ -576,7 +578,7 @@ int LAndExpAST::value(void)
         return left_exp->value();
 
     int res = 0;
-    if(op == "&&")
+    if(op == OP_AND)
         res = left_exp->value() && right_exp->value();
 
     return res;
@@ -589,7 +591,7 @@ LOrExpAST::LOrExpAST(std::unique_ptr<BaseAST> &_primary_exp)
 
     return;
 }
-LOrExpAST::LOrExpAST(std::unique_ptr<BaseAST> &_left_exp, std::string _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
+LOrExpAST::LOrExpAST(std::unique_ptr<BaseAST> &_left_exp, OpType _op, std::unique_ptr<BaseAST> &_right_exp) : op(_op)
 {
     type = OP;
     left_exp = std::move(_left_exp);
@@ -608,25 +610,25 @@ void *LOrExpAST::to_koopa(void)
         res = (koopa_raw_value_data *)left_exp->to_koopa();
         break;
     case OP:
-        koopa_raw_value_data *temp_var = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}}, "%temp", {nullptr, 0, KOOPA_RSIK_TYPE}, {.tag = KOOPA_RVT_ALLOC}};
-        koopa_raw_value_data *temp_store = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = (koopa_raw_value_t)NumberAST(1).to_koopa()}};
-        block_inst.add_inst(temp_var);
-        block_inst.add_inst(temp_store);
+        koopa_raw_value_data *temp_var = context->arena.make(koopa_raw_value_data{context->type_table.pointer(context->type_table.int32()), "%temp", {nullptr, 0, KOOPA_RSIK_TYPE}, {.tag = KOOPA_RVT_ALLOC}});
+        koopa_raw_value_data *temp_store = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = context->const_pool.integer(1)}});
+        context->block_inst.add_inst(temp_var);
+        context->block_inst.add_inst(temp_store);
 
-        koopa_raw_basic_block_data_t *true_block = new koopa_raw_basic_block_data_t{"%true", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-        koopa_raw_basic_block_data_t *end_block = new koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}};
-        koopa_raw_value_data *branch = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = to_bool(&block_inst, (koopa_raw_value_t)left_exp->to_koopa(), KOOPA_RBO_EQ), .data.branch.true_bb = true_block, .data.branch.false_bb = end_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}};
-        block_inst.add_inst(branch);
+        koopa_raw_basic_block_data_t *true_block = context->arena.make(koopa_raw_basic_block_data_t{"%true", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+        koopa_raw_basic_block_data_t *end_block = context->arena.make(koopa_raw_basic_block_data_t{"%end", {nullptr, 0, KOOPA_RSIK_VALUE}, {nullptr, 0, KOOPA_RSIK_VALUE}, {}});
+        koopa_raw_value_data *branch = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_BRANCH, .data.branch.cond = to_bool(&context->block_inst, (koopa_raw_value_t)left_exp->to_koopa(), KOOPA_RBO_EQ), .data.branch.true_bb = true_block, .data.branch.false_bb = end_block, .data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE}}});
+        context->block_inst.add_inst(branch);
 
-        block_inst.new_block(true_block);
-        koopa_raw_value_data *right_store = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = to_bool(&block_inst, (koopa_raw_value_t)right_exp->to_koopa(), KOOPA_RBO_NOT_EQ)}};
-        block_inst.add_inst(right_store);
-        block_inst.add_inst(new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}});
+        context->block_inst.new_block(true_block);
+        koopa_raw_value_data *right_store = context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_UNKNOWN}, {.tag = KOOPA_RVT_STORE, .data.store.dest = temp_var, .data.store.value = to_bool(&context->block_inst, (koopa_raw_value_t)right_exp->to_koopa(), KOOPA_RBO_NOT_EQ)}});
+        context->block_inst.add_inst(right_store);
+        context->block_inst.add_inst(context->arena.make(koopa_raw_value_data{context->type_table.unit(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_JUMP, .data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE}, .data.jump.target = end_block}}));
 
-        block_inst.new_block(end_block);
-        res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = temp_var}};
+        context->block_inst.new_block(end_block);
+        res = context->arena.make(koopa_raw_value_data{context->type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_LOAD, .data.load.src = temp_var}});
 
-        block_inst.add_inst(res);
+        context->block_inst.add_inst(res);
         break;
     }
 
@@ -639,7 +641,7 @@ int LOrExpAST::value(void)
         return left_exp->value();
 
     int res = 0;
-    if(op == "||")
+    if(op == OP_OR)
         res = left_exp->value() || right_exp->value();
 
     return res;
@@ -652,9 +654,7 @@ NumberAST::NumberAST(int _val) : val(_val)
 
 void *NumberAST::to_koopa(void)
 {
-    koopa_raw_value_data *res = new koopa_raw_value_data{new koopa_raw_type_kind{.tag = KOOPA_RTT_INT32}, nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = val}};
-
-    return res;
+    return (void *)context->const_pool.integer(val);
 }
 
 int NumberAST::value(void)
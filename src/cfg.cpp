@@ -0,0 +1,183 @@
+#include <utility>
+#include <vector>
+#include "cfg.hpp"
+
+CFG::CFG(int n) : rank(n, -1), succ(n), pred(n), idom(n, -1), depth(n, 0)
+{
+    return;
+}
+
+void CFG::add_edge(int from, int to)
+{
+    succ[from].push_back(to);
+    pred[to].push_back(from);
+
+    return;
+}
+
+int CFG::intersect(int a, int b)
+{
+    while(a != b)
+    {
+        while(rank[a] > rank[b])
+            a = idom[a];
+        while(rank[b] > rank[a])
+            b = idom[b];
+    }
+
+    return a;
+}
+
+void CFG::analyze(void)
+{
+    int n = succ.size();
+    if(!n)
+        return;
+
+    // 非递归 DFS 求逆后序
+    std::vector<int> post;
+    std::vector<char> seen(n, false);
+    std::vector<std::pair<int, int>> stack = {{0, 0}};
+    seen[0] = true;
+    while(!stack.empty())
+    {
+        auto &[b, i] = stack.back();
+        if(i < (int)succ[b].size())
+        {
+            int s = succ[b][i ++];
+            if(!seen[s])
+            {
+                seen[s] = true;
+                stack.push_back({s, 0});
+            }
+        }
+        else
+        {
+            post.push_back(b);
+            stack.pop_back();
+        }
+    }
+    order.assign(post.rbegin(), post.rend());
+    for(int i = 0; i < (int)order.size(); i ++)
+        rank[order[i]] = i;
+
+    // Cooper-Harvey-Kennedy 迭代求直接支配结点
+    idom[0] = 0;
+    for(bool changed = true; changed; )
+    {
+        changed = false;
+        for(int i = 1; i < (int)order.size(); i ++)
+        {
+            int b = order[i], dom = -1;
+            for(int p : pred[b])
+                if(idom[p] != -1)
+                    dom = dom == -1 ? p : intersect(p, dom);
+            if(dom != idom[b])
+            {
+                idom[b] = dom;
+                changed = true;
+            }
+        }
+    }
+
+    // 回边 b -> h 确定一个以 h 为头的自然循环, 循环体内的结点深度加一
+    std::vector<std::vector<int>> latches(n);
+    for(int b : order)
+        for(int h : succ[b])
+            if(dominates(h, b))
+                latches[h].push_back(b);
+    std::vector<int> mark(n, -1), work;
+    for(int h = 0; h < n; h ++)
+    {
+        if(latches[h].empty())
+            continue;
+        mark[h] = h;
+        depth[h] ++;
+        for(int b : latches[h])
+            if(mark[b] != h)
+            {
+                mark[b] = h;
+                depth[b] ++;
+                work.push_back(b);
+            }
+        while(!work.empty())
+        {
+            int b = work.back();
+            work.pop_back();
+            for(int p : pred[b])
+                if(rank[p] != -1 && mark[p] != h)
+                {
+                    mark[p] = h;
+                    depth[p] ++;
+                    work.push_back(p);
+                }
+        }
+    }
+
+    return;
+}
+
+bool CFG::reachable(int b)
+{
+    return rank[b] != -1;
+}
+
+bool CFG::dominates(int a, int b)
+{
+    if(rank[a] == -1 || rank[b] == -1)
+        return false;
+    while(b != a && b != 0)
+        b = idom[b];
+
+    return b == a;
+}
+
+// blocks 中可达的块的最近公共支配结点, 都不可达时返回 -1
+int CFG::dominator(const std::vector<int> &blocks)
+{
+    int res = -1;
+    for(int b : blocks)
+        if(reachable(b))
+            res = res == -1 ? b : intersect(res, b);
+
+    return res;
+}
+
+// 收缩包装的插入点: 支配 blocks 中的所有块, 不在循环中, 并且从它出发能到达的块都被它支配
+// 从这里进入的区域最多进入一次, 离开区域只能通过返回; blocks 都不可达时返回 -1
+int CFG::wrap(const std::vector<int> &blocks)
+{
+    int res = dominator(blocks);
+    if(res == -1)
+        return -1;
+
+    auto closed = [&](int head)
+    {
+        std::vector<char> seen(succ.size(), false);
+        std::vector<int> work = {head};
+        seen[head] = true;
+        while(!work.empty())
+        {
+            int b = work.back();
+            work.pop_back();
+            if(!dominates(head, b))
+                return false;
+            for(int s : succ[b])
+                if(!seen[s])
+                {
+                    seen[s] = true;
+                    work.push_back(s);
+                }
+        }
+        return true;
+    };
+    while(res && (depth[res] || !closed(res)))
+        res = idom[res];
+
+    return res;
+}
+
+const std::vector<int> &CFG::rpo(void)
+{
+    return order;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+// 控制流图: 结点为基本块编号, 0 号为入口, 计算支配树和循环嵌套深度
+class CFG
+{
+private:
+    std::vector<int> order, rank;
+
+    int intersect(int a, int b);
+
+public:
+    std::vector<std::vector<int>> succ, pred;
+    std::vector<int> idom, depth;
+
+    CFG(int n);
+
+    void add_edge(int from, int to);
+    void analyze(void);
+    bool reachable(int b);
+    bool dominates(int a, int b);
+    int dominator(const std::vector<int> &blocks);
+    int wrap(const std::vector<int> &blocks);
+    const std::vector<int> &rpo(void);
+};
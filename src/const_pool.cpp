@@ -0,0 +1,30 @@
+#include <algorithm>
+#include <cstdint>
+#include "arena.hpp"
+#include "const_pool.hpp"
+#include "koopa.h"
+#include "type_table.hpp"
+
+ConstPool::ConstPool(Arena &_arena, TypeTable &_type_table) : arena(_arena), type_table(_type_table)
+{
+    std::fill(small, small + SMALL_MAX - SMALL_MIN + 1, nullptr);
+
+    return;
+}
+
+koopa_raw_value_t ConstPool::integer(int32_t value)
+{
+    koopa_raw_value_t &res = value >= SMALL_MIN && value <= SMALL_MAX ? small[value - SMALL_MIN] : others[value];
+    if(!res)
+        res = arena.make(koopa_raw_value_data{type_table.int32(), nullptr, {nullptr, 0, KOOPA_RSIK_VALUE}, {.tag = KOOPA_RVT_INTEGER, .data.integer.value = value}});
+
+    return res;
+}
+
+void ConstPool::clear(void)
+{
+    std::fill(small, small + SMALL_MAX - SMALL_MIN + 1, nullptr);
+    others.clear();
+
+    return;
+}
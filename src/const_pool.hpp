@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include "arena.hpp"
+#include "koopa.h"
+#include "type_table.hpp"
+
+// 整数常量池: 每个整数值只对应一个 Koopa 结点
+class ConstPool
+{
+private:
+    static const int SMALL_MIN = -16, SMALL_MAX = 255;
+
+    Arena &arena;
+    TypeTable &type_table;
+    koopa_raw_value_t small[SMALL_MAX - SMALL_MIN + 1];
+    std::unordered_map<int32_t, koopa_raw_value_t> others;
+
+public:
+    ConstPool(Arena &_arena, TypeTable &_type_table);
+
+    koopa_raw_value_t integer(int32_t value);
+
+    void clear(void);
+};
@@ -0,0 +1,17 @@
+#include "ast.hpp"
+#include "context.hpp"
+
+Context::Context(void) : type_table(arena), const_pool(arena, type_table)
+{
+    prev = BaseAST::context;
+    BaseAST::context = this;
+
+    return;
+}
+
+Context::~Context(void)
+{
+    BaseAST::context = prev;
+
+    return;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include "arena.hpp"
+#include "const_pool.hpp"
+#include "koopa.h"
+#include "table.hpp"
+#include "type_table.hpp"
+
+// 一次编译的全部状态, 构造时成为当前线程的编译上下文
+class Context
+{
+private:
+    Context *prev;
+
+public:
+    Arena arena;
+    TypeTable type_table;
+    ConstPool const_pool;
+    SymbolList symbol_list;
+    BlockInst block_inst;
+    std::vector<std::tuple<koopa_raw_basic_block_data_t *, koopa_raw_basic_block_data_t *, koopa_raw_basic_block_data_t *>> loop_inst;
+
+    Context(void);
+    ~Context(void);
+    Context(const Context &) = delete;
+    Context &operator=(const Context &) = delete;
+};
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <vector>
+#include "cfg.hpp"
+#include "frame.hpp"
+#include "mir.hpp"
+#include "regalloc.hpp"
+
+static bool in_range(int imm)
+{
+    return imm >= -2048 && imm <= 2047;
+}
+
+// 加入一条指令, 偏移量超出 12 位立即数范围时借助 t6 计算地址
+static void emit(std::vector<MInst> &insts, MInst inst)
+{
+    if((inst.op == RV_LW || inst.op == RV_SW || inst.op == RV_ADDI) && !in_range(inst.imm))
+    {
+        insts.push_back(MInst(RV_LI, T6, -1, -1, inst.imm));
+        if(inst.op == RV_ADDI)
+        {
+            insts.push_back(MInst(RV_ADD, inst.rd, inst.rs1, T6));
+            return;
+        }
+        insts.push_back(MInst(RV_ADD, T6, T6, inst.rs1));
+        inst.rs1 = T6;
+        inst.imm = 0;
+    }
+    insts.push_back(inst);
+
+    return;
+}
+
+// 只通过 lw/sw 整体读写的 4 字节对象按活跃区间着色, 返回每个对象的颜色, 不能共用的为 -1
+static std::vector<int> share_slots(MFunc &func, int &colors)
+{
+    int n = func.objects.size();
+    std::vector<char> shared(n);
+    std::vector<LinearScan::Block> blocks(func.blocks.size());
+
+    for(int i = 0; i < n; i ++)
+        shared[i] = func.objects[i].size == 4 && func.objects[i].arg == -1;
+    for(auto &blk : func.blocks)
+        for(auto &inst : blk.insts)
+            if(inst.slot != -1 && ((inst.op != RV_LW && inst.op != RV_SW) || inst.imm))
+                shared[inst.slot] = false;
+
+    for(int b = 0; b < (int)func.blocks.size(); b ++)
+    {
+        blocks[b].succ = func.succ(b);
+        blocks[b].depth = 0;
+        for(auto &minst : func.blocks[b].insts)
+        {
+            LinearScan::Inst inst;
+            if(minst.slot != -1 && shared[minst.slot])
+                (minst.op == RV_SW ? inst.defs : inst.uses).push_back(minst.slot);
+            blocks[b].insts.push_back(inst);
+        }
+    }
+
+    auto res = LinearScan(0).color(blocks, n);
+    colors = 0;
+    for(int i = 0; i < n; i ++)
+        if(!shared[i])
+            res[i] = -1;
+        else
+            colors = std::max(colors, res[i] + 1);
+
+    return res;
+}
+
+// 确定各区域的大小和位置, 以及每个栈上对象的偏移量
+static void layout(MFunc &func)
+{
+    int colors;
+    auto color = share_slots(func, colors);
+    auto &frame = func.frame;
+
+    std::vector<int> defs, uses;
+    std::vector<char> used(VREG, false);
+    for(auto &blk : func.blocks)
+        for(auto &inst : blk.insts)
+        {
+            defs.clear();
+            inst.regs(defs, uses);
+            for(int reg : defs)
+                used[reg] = true;
+        }
+    frame.regs.clear();
+    if(func.has_call)
+        frame.regs.push_back(RA);
+    for(int reg : callee_saved)
+        if(used[reg])
+            frame.regs.push_back(reg);
+
+    int locals = 0;
+    for(int i = 0; i < (int)func.objects.size(); i ++)
+        if(color[i] == -1 && func.objects[i].arg == -1)
+            locals += func.objects[i].size;
+    frame.slots = func.out_size;
+    frame.size = frame.slots + 4 * colors + locals + 4 * (int)frame.regs.size();
+    if(frame.size)
+        frame.size = ((frame.size - 1) / 16 + 1) * 16;
+    frame.saved = frame.size - 4 * (int)frame.regs.size();
+    frame.locals = frame.saved - locals;
+
+    int cur = frame.saved;
+    for(int i = 0; i < (int)func.objects.size(); i ++)
+        if(func.objects[i].arg != -1)
+            func.objects[i].offset = frame.size + 4 * func.objects[i].arg;
+        else if(color[i] != -1)
+            func.objects[i].offset = frame.slots + 4 * color[i];
+        else
+            func.objects[i].offset = (cur -= func.objects[i].size);
+
+    return;
+}
+
+// 收缩包装: 序言放在所有用到栈帧的块的公共支配结点上, 不用栈帧的路径上没有保存和恢复
+static int wrap_frame(MFunc &func, std::vector<char> &wrapped)
+{
+    int n = func.blocks.size();
+    auto &frame = func.frame;
+    CFG cfg(n);
+    std::vector<int> needs, defs, uses;
+
+    for(int b = 0; b < n; b ++)
+    {
+        bool need = false;
+        for(auto &inst : func.blocks[b].insts)
+        {
+            defs.clear();
+            uses.clear();
+            inst.regs(defs, uses);
+            need |= inst.slot != -1 || inst.op == RV_CALL || inst.rs1 == SP || inst.rs2 == SP;
+            for(int reg : frame.regs)
+                need |= std::count(defs.begin(), defs.end(), reg) || (reg != RA && std::count(uses.begin(), uses.end(), reg));
+        }
+        if(need)
+            needs.push_back(b);
+        for(int s : func.succ(b))
+            cfg.add_edge(b, s);
+    }
+    cfg.analyze();
+
+    int entry = cfg.wrap(needs);
+    if(entry == -1)
+        entry = 0;
+    for(int b = 0; b < n; b ++)
+        wrapped[b] = cfg.dominates(entry, b);
+
+    return entry;
+}
+
+// 计算栈帧布局, 插入序言和尾声, 并把栈上对象换成相对 sp 的偏移量
+void lower_frame(MFunc &func)
+{
+    layout(func);
+
+    auto &frame = func.frame;
+    int n = frame.regs.size();
+    std::vector<char> wrapped(func.blocks.size(), true);
+    if(frame.size)
+        frame.entry = wrap_frame(func, wrapped);
+    for(int b = 0; b < (int)func.blocks.size(); b ++)
+    {
+        std::vector<MInst> insts;
+        if(b == frame.entry)
+        {
+            if(frame.size)
+                emit(insts, MInst(RV_ADDI, SP, SP, -1, -frame.size));
+            for(int i = 0; i < n; i ++)
+                emit(insts, MInst(RV_SW, -1, SP, frame.regs[i], frame.size - 4 * (i + 1)));
+        }
+        for(auto inst : func.blocks[b].insts)
+        {
+            if((inst.op == RV_RET || inst.op == RV_TAIL) && wrapped[b])
+            {
+                for(int i = n - 1; i >= 0; i --)
+                    emit(insts, MInst(RV_LW, frame.regs[i], SP, -1, frame.size - 4 * (i + 1)));
+                if(frame.size)
+                    emit(insts, MInst(RV_ADDI, SP, SP, -1, frame.size));
+            }
+            if(inst.slot != -1)
+            {
+                inst.imm += func.objects[inst.slot].offset;
+                inst.slot = -1;
+            }
+            emit(insts, inst);
+        }
+        func.blocks[b].insts.swap(insts);
+    }
+
+    return;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "mir.hpp"
+
+void lower_frame(MFunc &func);
@@ -0,0 +1,307 @@
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include "koopa.h"
+#include "koopa_dump.hpp"
+#include "output.hpp"
+
+static thread_local std::set<std::string> global_names, local_names;
+static thread_local std::map<const void *, std::string> globals, names;
+static thread_local int temp_count;
+
+static const char *binary_op[] = {"ne", "eq", "gt", "lt", "ge", "le", "add", "sub", "mul", "div", "mod", "and", "or", "xor", "shl", "shr", "sar"};
+
+static const std::string &name_of(const void *item, const char *name)
+{
+    if(names.count(item))
+        return names[item];
+
+    std::string res;
+    if(!name)
+        res = "%" + std::to_string(temp_count ++);
+    else
+    {
+        res = name;
+        for(int i = 1; global_names.count(res) || local_names.count(res); i ++)
+            res = std::string(name) + "_" + std::to_string(i);
+    }
+    local_names.insert(res);
+
+    return names[item] = res;
+}
+
+static void dump_type(koopa_raw_type_t ty, Output &res)
+{
+    switch(ty->tag)
+    {
+    case KOOPA_RTT_INT32:
+        res << "i32";
+        break;
+    case KOOPA_RTT_UNIT:
+        res << "unit";
+        break;
+    case KOOPA_RTT_ARRAY:
+        res << "[";
+        dump_type(ty->data.array.base, res);
+        res << ", " << ty->data.array.len << "]";
+        break;
+    case KOOPA_RTT_POINTER:
+        res << "*";
+        dump_type(ty->data.pointer.base, res);
+        break;
+    case KOOPA_RTT_FUNCTION:
+        res << "(";
+        for(int i = 0; i < (int)ty->data.function.params.len; i ++)
+        {
+            if(i)
+                res << ", ";
+            dump_type((koopa_raw_type_t)ty->data.function.params.buffer[i], res);
+        }
+        res << ")";
+        if(ty->data.function.ret->tag != KOOPA_RTT_UNIT)
+        {
+            res << ": ";
+            dump_type(ty->data.function.ret, res);
+        }
+        break;
+    default:
+        throw std::runtime_error("error: unknown ty.tag " + std::to_string(ty->tag));
+    }
+
+    return;
+}
+
+static void dump_operand(koopa_raw_value_t kval, Output &res)
+{
+    switch(kval->kind.tag)
+    {
+    case KOOPA_RVT_INTEGER:
+        res << kval->kind.data.integer.value;
+        break;
+    case KOOPA_RVT_ZERO_INIT:
+        res << "zeroinit";
+        break;
+    case KOOPA_RVT_UNDEF:
+        res << "undef";
+        break;
+    case KOOPA_RVT_AGGREGATE:
+        res << "{";
+        for(int i = 0; i < (int)kval->kind.data.aggregate.elems.len; i ++)
+        {
+            if(i)
+                res << ", ";
+            dump_operand((koopa_raw_value_t)kval->kind.data.aggregate.elems.buffer[i], res);
+        }
+        res << "}";
+        break;
+    default:
+        res << name_of(kval, kval->name);
+        break;
+    }
+
+    return;
+}
+
+static void dump_args(const koopa_raw_slice_t &args, Output &res)
+{
+    if(!args.len)
+        return;
+
+    res << "(";
+    for(int i = 0; i < (int)args.len; i ++)
+    {
+        if(i)
+            res << ", ";
+        dump_operand((koopa_raw_value_t)args.buffer[i], res);
+    }
+    res << ")";
+
+    return;
+}
+
+static void dump_target(koopa_raw_basic_block_t kblk, const koopa_raw_slice_t &args, Output &res)
+{
+    res << name_of(kblk, kblk->name);
+    dump_args(args, res);
+
+    return;
+}
+
+static void dump_value(koopa_raw_value_t kval, Output &res)
+{
+    auto &data = kval->kind.data;
+
+    res << "  ";
+    if(kval->ty->tag != KOOPA_RTT_UNIT)
+        res << name_of(kval, kval->name) << " = ";
+
+    switch(kval->kind.tag)
+    {
+    case KOOPA_RVT_ALLOC:
+        res << "alloc ";
+        dump_type(kval->ty->data.pointer.base, res);
+        break;
+    case KOOPA_RVT_LOAD:
+        res << "load ";
+        dump_operand(data.load.src, res);
+        break;
+    case KOOPA_RVT_STORE:
+        res << "store ";
+        dump_operand(data.store.value, res);
+        res << ", ";
+        dump_operand(data.store.dest, res);
+        break;
+    case KOOPA_RVT_GET_PTR:
+        res << "getptr ";
+        dump_operand(data.get_ptr.src, res);
+        res << ", ";
+        dump_operand(data.get_ptr.index, res);
+        break;
+    case KOOPA_RVT_GET_ELEM_PTR:
+        res << "getelemptr ";
+        dump_operand(data.get_elem_ptr.src, res);
+        res << ", ";
+        dump_operand(data.get_elem_ptr.index, res);
+        break;
+    case KOOPA_RVT_BINARY:
+        res << binary_op[data.binary.op] << " ";
+        dump_operand(data.binary.lhs, res);
+        res << ", ";
+        dump_operand(data.binary.rhs, res);
+        break;
+    case KOOPA_RVT_BRANCH:
+        res << "br ";
+        dump_operand(data.branch.cond, res);
+        res << ", ";
+        dump_target(data.branch.true_bb, data.branch.true_args, res);
+        res << ", ";
+        dump_target(data.branch.false_bb, data.branch.false_args, res);
+        break;
+    case KOOPA_RVT_JUMP:
+        res << "jump ";
+        dump_target(data.jump.target, data.jump.args, res);
+        break;
+    case KOOPA_RVT_CALL:
+        res << "call " << data.call.callee->name << "(";
+        for(int i = 0; i < (int)data.call.args.len; i ++)
+        {
+            if(i)
+                res << ", ";
+            dump_operand((koopa_raw_value_t)data.call.args.buffer[i], res);
+        }
+        res << ")";
+        break;
+    case KOOPA_RVT_RETURN:
+        res << "ret";
+        if(data.ret.value)
+        {
+            res << " ";
+            dump_operand(data.ret.value, res);
+        }
+        break;
+    default:
+        throw std::runtime_error("error: unknown kval.tag " + std::to_string(kval->kind.tag));
+    }
+    res << "\n";
+
+    return;
+}
+
+static void dump_block(koopa_raw_basic_block_t kblk, Output &res)
+{
+    res << name_of(kblk, kblk->name);
+    if(kblk->params.len)
+    {
+        res << "(";
+        for(int i = 0; i < (int)kblk->params.len; i ++)
+        {
+            koopa_raw_value_t param = (koopa_raw_value_t)kblk->params.buffer[i];
+            if(i)
+                res << ", ";
+            res << name_of(param, param->name) << ": ";
+            dump_type(param->ty, res);
+        }
+        res << ")";
+    }
+    res << ":\n";
+    for(int i = 0; i < (int)kblk->insts.len; i ++)
+        dump_value((koopa_raw_value_t)kblk->insts.buffer[i], res);
+
+    return;
+}
+
+static void dump_func(koopa_raw_function_t kfunc, Output &res)
+{
+    koopa_raw_type_t ret = kfunc->ty->data.function.ret;
+
+    if(!kfunc->bbs.len)
+    {
+        res << "decl " << kfunc->name;
+        dump_type(kfunc->ty, res);
+        res << "\n";
+        return;
+    }
+
+    local_names.clear();
+    names = globals;
+    temp_count = 0;
+
+    res << "\nfun " << kfunc->name << "(";
+    for(int i = 0; i < (int)kfunc->params.len; i ++)
+    {
+        koopa_raw_value_t param = (koopa_raw_value_t)kfunc->params.buffer[i];
+        if(i)
+            res << ", ";
+        res << name_of(param, param->name) << ": ";
+        dump_type(param->ty, res);
+    }
+    res << ")";
+    if(ret->tag != KOOPA_RTT_UNIT)
+    {
+        res << ": ";
+        dump_type(ret, res);
+    }
+    res << " {\n";
+    for(int i = 0; i < (int)kfunc->bbs.len; i ++)
+    {
+        if(i)
+            res << "\n";
+        dump_block((koopa_raw_basic_block_t)kfunc->bbs.buffer[i], res);
+    }
+    res << "}\n";
+
+    return;
+}
+
+static void dump_global(koopa_raw_value_t kval, Output &res)
+{
+    std::string name = kval->name;
+    for(int i = 1; global_names.count(name); i ++)
+        name = std::string(kval->name) + "_" + std::to_string(i);
+    global_names.insert(name);
+    globals[kval] = name;
+
+    res << "global " << name << " = alloc ";
+    dump_type(kval->ty->data.pointer.base, res);
+    res << ", ";
+    dump_operand(kval->kind.data.global_alloc.init, res);
+    res << "\n";
+
+    return;
+}
+
+void koopa2text(const koopa_raw_program_t *krp, Output &res)
+{
+    global_names.clear();
+    globals.clear();
+    for(int i = 0; i < (int)krp->funcs.len; i ++)
+        global_names.insert(((koopa_raw_function_t)krp->funcs.buffer[i])->name);
+
+    for(int i = 0; i < (int)krp->values.len; i ++)
+        dump_global((koopa_raw_value_t)krp->values.buffer[i], res);
+    for(int i = 0; i < (int)krp->funcs.len; i ++)
+        dump_func((koopa_raw_function_t)krp->funcs.buffer[i], res);
+
+    return;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "koopa.h"
+#include "output.hpp"
+
+void koopa2text(const koopa_raw_program_t *krp, Output &res);
@@ -0,0 +1,10 @@
+#include "koopa.h"
+#include "koopa_util.hpp"
+
+bool frame_pointer(koopa_raw_value_t kval)
+{
+    while(kval->kind.tag == KOOPA_RVT_GET_PTR || kval->kind.tag == KOOPA_RVT_GET_ELEM_PTR)
+        kval = kval->kind.tag == KOOPA_RVT_GET_PTR ? kval->kind.data.get_ptr.src : kval->kind.data.get_elem_ptr.src;
+
+    return kval->kind.tag == KOOPA_RVT_ALLOC;
+}
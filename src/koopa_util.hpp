@@ -0,0 +1,6 @@
+#pragma once
+
+#include "koopa.h"
+
+// 指针是否可能指向当前函数栈帧上的数组, 前端的尾递归消除和后端的尾调用由此判断实参能否在栈帧释放后使用
+bool frame_pointer(koopa_raw_value_t kval);
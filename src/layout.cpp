@@ -0,0 +1,95 @@
+#include <vector>
+#include "cfg.hpp"
+#include "layout.hpp"
+#include "mir.hpp"
+
+// 排列基本块的顺序: 沿着循环深度最大的后继连成一条链, 让循环体连续, 循环出口放到后面
+static std::vector<int> block_order(MFunc &func)
+{
+    int n = func.blocks.size();
+    CFG cfg(n);
+    std::vector<int> order, rank(n);
+    std::vector<bool> placed(n, false);
+
+    for(int b = 0; b < n; b ++)
+        for(int s : func.succ(b))
+            cfg.add_edge(b, s);
+    cfg.analyze();
+    for(int i = 0; i < (int)cfg.rpo().size(); i ++)
+        rank[cfg.rpo()[i]] = i;
+
+    // 新链从前驱已经放好的块中, 循环最深, 逆后序最靠前的块开始
+    auto better = [&](int a, int b)
+    {
+        return b == -1 || cfg.depth[a] > cfg.depth[b] || (cfg.depth[a] == cfg.depth[b] && rank[a] < rank[b]);
+    };
+
+    for(int cur = 0; cur != -1; )
+    {
+        while(cur != -1)
+        {
+            placed[cur] = true;
+            order.push_back(cur);
+            int next = -1;
+            for(int s : cfg.succ[cur])
+                if(!placed[s] && better(s, next))
+                    next = s;
+            cur = next;
+        }
+        for(int b : cfg.rpo())
+            if(!placed[b])
+                for(int p : cfg.pred[b])
+                    if(placed[p] && better(b, cur))
+                        cur = b;
+    }
+
+    return order;
+}
+
+void layout_blocks(MFunc &func)
+{
+    int n = func.blocks.size();
+
+    // 原来落到下一个块的地方先补上跳转
+    for(int b = 0; b + 1 < n; b ++)
+    {
+        auto &insts = func.blocks[b].insts;
+        if(insts.empty() || (insts.back().op != RV_J && insts.back().op != RV_RET && insts.back().op != RV_TAIL))
+            insts.emplace_back(RV_J).target = b + 1;
+    }
+
+    auto order = block_order(func);
+    std::vector<int> index(n, -1);
+    std::vector<MBlock> blocks;
+    for(int i = 0; i < (int)order.size(); i ++)
+        index[order[i]] = i;
+    for(int b : order)
+        blocks.push_back(std::move(func.blocks[b]));
+    func.blocks.swap(blocks);
+
+    // 不可达的块已经去掉, 剩下的跳转目标都在新的顺序中
+    n = func.blocks.size();
+    for(int b = 0; b < n; b ++)
+    {
+        auto &insts = func.blocks[b].insts;
+        for(auto &inst : insts)
+            if(inst.target != -1)
+                inst.target = index[inst.target];
+
+        // 跳到下一个块的 j 可以去掉; 条件跳转到下一个块时取反, 改为落到下一个块
+        if(!insts.empty() && insts.back().op == RV_J && insts.back().target == b + 1)
+        {
+            insts.pop_back();
+            continue;
+        }
+        int m = insts.size();
+        if(m >= 2 && insts[m - 2].is_branch() && insts[m - 1].op == RV_J && insts[m - 2].target == b + 1)
+        {
+            insts[m - 2].op = inverse_branch(insts[m - 2].op);
+            insts[m - 2].target = insts[m - 1].target;
+            insts.pop_back();
+        }
+    }
+
+    return;
+}
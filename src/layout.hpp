@@ -0,0 +1,5 @@
+#pragma once
+
+#include "mir.hpp"
+
+void layout_blocks(MFunc &func);
@@ -0,0 +1,302 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "ast.hpp"
+#include "lexer.hpp"
+#include "sysy.tab.hpp"
+
+int yylex(YYSTYPE *lval, ParseState &state)
+{
+    return state.lexer.lex(*lval);
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_ident(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int hex_digit(char c)
+{
+    if(c >= '0' && c <= '9')
+        return c - '0';
+    if(c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+// 跳过空白符, 返回第一个非空白字符的位置
+static const char *skip_space(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    while(end - p >= 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, space), _mm_cmpeq_epi8(c, tab)), _mm_or_si128(_mm_cmpeq_epi8(c, lf), _mm_cmpeq_epi8(c, cr)));
+        unsigned mask = ~_mm_movemask_epi8(hit) & 0xffff;
+        if(mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t space = vdupq_n_u8(' '), tab = vdupq_n_u8('\t'), lf = vdupq_n_u8('\n'), cr = vdupq_n_u8('\r');
+    while(end - p >= 16)
+    {
+        uint8x16_t c = vld1q_u8((const uint8_t *)p);
+        uint8x16_t miss = vmvnq_u8(vorrq_u8(vorrq_u8(vceqq_u8(c, space), vceqq_u8(c, tab)), vorrq_u8(vceqq_u8(c, lf), vceqq_u8(c, cr))));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(miss), 4)), 0);
+        if(mask)
+            return p + __builtin_ctzll(mask) / 4;
+        p += 16;
+    }
+#endif
+    while(p < end && is_space(*p))
+        p ++;
+
+    return p;
+}
+
+// 找到 ch 第一次出现的位置, 找不到时返回 end
+static const char *find_char(const char *p, const char *end, char ch)
+{
+#if defined(__SSE2__)
+    const __m128i target = _mm_set1_epi8(ch);
+    while(end - p >= 16)
+    {
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), target));
+        if(mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t target = vdupq_n_u8(ch);
+    while(end - p >= 16)
+    {
+        uint8x16_t hit = vceqq_u8(vld1q_u8((const uint8_t *)p), target);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+        if(mask)
+            return p + __builtin_ctzll(mask) / 4;
+        p += 16;
+    }
+#endif
+    while(p < end && *p != ch)
+        p ++;
+
+    return p;
+}
+
+static const struct
+{
+    std::string_view word;
+    int token;
+} keywords[] = {
+    {"int", INT}, {"return", RETURN}, {"const", CONST}, {"if", IF}, {"else", ELSE},
+    {"while", _WHILE}, {"break", _BREAK}, {"continue", _CONTINUE}, {"void", VOID}
+};
+
+Lexer::Lexer(const char *path) : data(nullptr), size(0)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error("error: cannot open " + std::string(path));
+
+    struct stat st;
+    if(fstat(fd, &st) < 0)
+    {
+        close(fd);
+        throw std::runtime_error("error: cannot stat " + std::string(path));
+    }
+    size = st.st_size;
+    if(size)
+    {
+        void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("error: cannot map " + std::string(path));
+        }
+        data = (const char *)map;
+        madvise(map, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    cur = data;
+    end = data + size;
+
+    return;
+}
+
+Lexer::~Lexer(void)
+{
+    if(data)
+        munmap((void *)data, size);
+
+    return;
+}
+
+const std::string *Lexer::intern(std::string_view s)
+{
+    auto it = idents.find(s);
+    if(it != idents.end())
+        return it->second;
+
+    const std::string *res = &storage.emplace_back(s);
+    idents.emplace(*res, res);
+
+    return res;
+}
+
+int Lexer::number(void)
+{
+    uint32_t val = 0;
+
+    if(cur[0] == '0' && end - cur >= 3 && (cur[1] == 'x' || cur[1] == 'X') && hex_digit(cur[2]) >= 0)
+    {
+        for(cur += 2; cur < end && hex_digit(*cur) >= 0; cur ++)
+            val = val * 16 + hex_digit(*cur);
+    }
+    else if(cur[0] == '0')
+    {
+        for(cur ++; cur < end && *cur >= '0' && *cur <= '7'; cur ++)
+            val = val * 8 + (*cur - '0');
+    }
+    else
+    {
+        for(; cur < end && is_digit(*cur); cur ++)
+            val = val * 10 + (*cur - '0');
+    }
+
+    return (int)val;
+}
+
+int Lexer::lex(YYSTYPE &lval)
+{
+    while(true)
+    {
+        cur = skip_space(cur, end);
+        if(cur >= end)
+            return 0;
+        if(cur[0] != '/' || end - cur < 2)
+            break;
+        if(cur[1] == '/')
+            cur = find_char(cur + 2, end, '\n');
+        else if(cur[1] == '*')
+        {
+            const char *p = cur + 2;
+            while(true)
+            {
+                p = find_char(p, end, '*');
+                if(p >= end || (end - p >= 2 && p[1] == '/'))
+                    break;
+                p ++;
+            }
+            cur = p >= end ? end : p + 2;
+        }
+        else
+            break;
+    }
+
+    const char *start = cur;
+    char c = *cur;
+
+    if(is_ident(c) && !is_digit(c))
+    {
+        while(cur < end && is_ident(*cur))
+            cur ++;
+        std::string_view word(start, cur - start);
+        for(auto &keyword : keywords)
+            if(keyword.word == word)
+                return keyword.token;
+        lval.str_val = intern(word);
+        return IDENT;
+    }
+    if(is_digit(c))
+    {
+        lval.int_val = number();
+        return INT_CONST;
+    }
+
+    char next = end - cur >= 2 ? cur[1] : 0;
+    cur ++;
+    switch(c)
+    {
+    case '+':
+        lval.int_val = OP_ADD;
+        return ADDOP;
+    case '-':
+        lval.int_val = OP_SUB;
+        return ADDOP;
+    case '*':
+        lval.int_val = OP_MUL;
+        return MULOP;
+    case '/':
+        lval.int_val = OP_DIV;
+        return MULOP;
+    case '%':
+        lval.int_val = OP_MOD;
+        return MULOP;
+    case '<':
+    case '>':
+        if(next == '=')
+        {
+            cur ++;
+            lval.int_val = c == '<' ? OP_LE : OP_GE;
+        }
+        else
+            lval.int_val = c == '<' ? OP_LT : OP_GT;
+        return RELOP;
+    case '=':
+        if(next != '=')
+            return '=';
+        cur ++;
+        lval.int_val = OP_EQ;
+        return EQOP;
+    case '!':
+        if(next != '=')
+        {
+            lval.int_val = OP_NOT;
+            return UNARYOP;
+        }
+        cur ++;
+        lval.int_val = OP_NE;
+        return EQOP;
+    case '&':
+        if(next != '&')
+            return '&';
+        cur ++;
+        lval.int_val = OP_AND;
+        return LANDOP;
+    case '|':
+        if(next != '|')
+            return '|';
+        cur ++;
+        lval.int_val = OP_OR;
+        return LOROP;
+    default:
+        return (unsigned char)c;
+    }
+}
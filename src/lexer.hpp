@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+union YYSTYPE;
+
+// 基于 mmap 的词法分析器: 直接在映射的输入上扫描, 标识符唯一化, 运算符返回 OpType
+class Lexer
+{
+private:
+    const char *data, *cur, *end;
+    size_t size;
+    std::deque<std::string> storage;
+    std::unordered_map<std::string_view, const std::string *> idents;
+
+    const std::string *intern(std::string_view s);
+    int number(void);
+
+public:
+    Lexer(const char *path);
+    ~Lexer(void);
+    Lexer(const Lexer &) = delete;
+    Lexer &operator=(const Lexer &) = delete;
+
+    int lex(YYSTYPE &lval);
+};
@@ -1,58 +1,186 @@
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #include "ast.hpp"
+#include "context.hpp"
 #include "koopa.h"
+#include "koopa_dump.hpp"
+#include "lexer.hpp"
+#include "output.hpp"
 #include "riscv.hpp"
+#include "schedule.hpp"
+#include "sysy.tab.hpp"
 
-extern FILE *yyin;
-extern int yyparse(std::unique_ptr<BaseAST> &ast);
-
-int main(int argc, const char *argv[])
+static void compile(const std::string &mode, const char *input, const char *output, bool echo, bool async, bool stats, int jobs, const std::string &tune)
 {
-    // 解析命令行参数. 测试脚本/评测平台要求你的编译器能接收如下参数:
-    // compiler 模式 输入文件 -o 输出文件
-    if(argc != 5)
-        return 1;
+    if(mode != "-koopa" && mode != "-riscv" && mode != "-perf")
+        throw std::runtime_error("error: unknown mode " + mode);
+    Pipeline pipeline = find_pipeline(tune);
 
-    auto mode = argv[1];
-    auto input = argv[2];
-    auto output = argv[4];
+    // 本次编译的全部状态都放在 context 里, 不同线程上的编译互不干扰
+    Context context;
 
-    // 打开输入文件, 并且指定 lexer 在解析的时候读取这个文件
-    yyin = fopen(input, "r");
+    // 映射输入文件, 并且指定 lexer 在解析的时候读取这个文件
+    Lexer lexer(input);
+    ParseState state(lexer);
 
     // 调用 parser 函数, parser 函数会进一步调用 lexer 解析输入文件的
     std::unique_ptr<BaseAST> ast;
-    yyparse(ast);
-
-    static char buffer[1U << 22];
-    size_t sz = 1U << 22;
+    yyparse(ast, state);
 
     std::unique_ptr<CompUnitAST> comp_ast((CompUnitAST *)ast.release());
     koopa_raw_program_t krp = comp_ast->to_koopa_program();
-    koopa_program_t kp;
-    koopa_generate_raw_to_koopa(&krp, &kp);
-    koopa_dump_to_string(kp, buffer, &sz);
-    koopa_delete_program(kp);
 
-    if(std::string(mode) == "-riscv" || std::string(mode) == "-perf")
+    std::ostringstream report;
+    Output out(output, echo, async);
+    if(mode == "-koopa")
+        koopa2text(&krp, out);
+    else
+        koopa2riscv(&krp, out, pipeline, jobs, stats ? &report : nullptr);
+    out.close();
+
+    if(stats)
     {
-        koopa_program_t new_kp;
-        koopa_parse_from_string(buffer, &new_kp);
-        koopa_raw_program_builder_t kp_builder = koopa_new_raw_program_builder();
-        koopa_raw_program_t new_krp = koopa_build_raw_program(kp_builder, new_kp);
-        koopa_delete_program(new_kp);
-
-        std::string riscv = koopa2riscv(&new_krp);
-        buffer[riscv.copy(buffer, riscv.size())] = 0;
+        context.arena.report(report);
+        std::cerr << report.str();
     }
-    else if(std::string(mode) != "-koopa")
-        throw std::runtime_error("error: unknown mode " + std::string(mode));
 
-    std::cout << buffer;
-    std::ofstream yyout(output);
-    yyout << buffer;
+    return;
+}
+
+static std::string output_path(const std::string &input, const std::string &mode)
+{
+    std::string res = input;
+
+    if(res.size() > 3 && res.compare(res.size() - 3, 3, ".sy") == 0)
+        res.resize(res.size() - 3);
+
+    return res + (mode == "-koopa" ? ".koopa" : ".S");
+}
+
+// 解析 -j 的线程数, 不是整数时返回 0
+static int parse_jobs(const char *arg)
+{
+    int res = 0;
+    const char *end = arg + strlen(arg);
+    std::from_chars_result parsed = std::from_chars(arg, end, res);
+    if(parsed.ec != std::errc() || parsed.ptr != end)
+        return 0;
+
+    return std::max(1, res);
+}
+
+static int batch(const std::string &mode, const std::vector<const char *> &inputs, int jobs, bool stats, const std::string &tune)
+{
+    std::atomic<int> next(0), failed(0);
+    std::mutex lock;
+    std::vector<std::thread> workers;
+
+    for(int i = 0; i < jobs; i ++)
+        workers.emplace_back([&]
+        {
+            for(int k = next ++; k < (int)inputs.size(); k = next ++)
+                try
+                {
+                    compile(mode, inputs[k], output_path(inputs[k], mode).c_str(), false, false, stats, 1, tune);
+                }
+                catch(const std::exception &e)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    std::cerr << inputs[k] << ": " << e.what() << std::endl;
+                    failed ++;
+                }
+        });
+    for(auto &worker : workers)
+        worker.join();
+
+    return failed ? 1 : 0;
+}
+
+int main(int argc, const char *argv[])
+{
+    // 批量模式: compiler --batch 模式 [-j 线程数] [-stats] [-mtune 核] 输入文件...
+    // 在一个进程内并发编译所有输入, a.sy 的结果写入 a.koopa 或 a.S
+    // 批量模式下每个程序内部串行生成代码, 单文件模式下各函数并行生成
+    if(argc >= 3 && std::string(argv[1]) == "--batch")
+    {
+        std::vector<const char *> inputs;
+        int jobs = std::max(1U, std::thread::hardware_concurrency());
+        bool stats = false;
+        std::string tune = "generic";
+
+        for(int i = 3; i < argc; i ++)
+            if(std::string(argv[i]) == "-j" && i + 1 < argc)
+            {
+                if(!(jobs = parse_jobs(argv[++ i])))
+                {
+                    std::cerr << "error: invalid -j value " << argv[i] << std::endl;
+                    return 1;
+                }
+            }
+            else if(std::string(argv[i]) == "-stats")
+                stats = true;
+            else if(std::string(argv[i]) == "-mtune" && i + 1 < argc)
+                tune = argv[++ i];
+            else
+                inputs.push_back(argv[i]);
+
+        return batch(argv[2], inputs, std::min(jobs, std::max(1, (int)inputs.size())), stats, tune);
+    }
+
+    // 解析命令行参数. 测试脚本/评测平台要求你的编译器能接收如下参数:
+    // compiler 模式 输入文件 -o 输出文件 [-echo] [-async] [-stats] [-j 线程数] [-mtune 核]
+    // -echo 把输出同时打印到标准输出, -async 由后台线程写入输出文件, -stats 打印 IR 内存占用和窥孔优化的统计
+    // -j 指定并行生成代码的线程数, 默认为处理器核数
+    // -mtune 指定指令调度使用的流水线延迟, 可以是 generic, rocket, sifive-e31, sifive-e76, 或者 "load,mul,div"
+    if(argc < 5)
+        return 1;
+
+    auto mode = argv[1];
+    auto input = argv[2];
+    auto output = argv[4];
+    bool echo = false, async = false, stats = false;
+    int jobs = std::max(1U, std::thread::hardware_concurrency());
+    std::string tune = "generic";
+
+    for(int i = 5; i < argc; i ++)
+        if(std::string(argv[i]) == "-echo")
+            echo = true;
+        else if(std::string(argv[i]) == "-async")
+            async = true;
+        else if(std::string(argv[i]) == "-stats")
+            stats = true;
+        else if(std::string(argv[i]) == "-j" && i + 1 < argc)
+        {
+            if(!(jobs = parse_jobs(argv[++ i])))
+            {
+                std::cerr << "error: invalid -j value " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if(std::string(argv[i]) == "-mtune" && i + 1 < argc)
+            tune = argv[++ i];
+        else
+            return 1;
+
+    try
+    {
+        compile(mode, input, output, echo, async, stats, jobs, tune);
+    }
+    catch(const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 
     return 0;
 }
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mir.hpp"
+#include "output.hpp"
+
+const char *reg_names[VREG] = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1",
+    "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7",
+    "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11",
+    "t3", "t4", "t5", "t6"
+};
+const std::vector<int> caller_saved = {RA, T0, T1, T2, A0, A1, A2, A3, A4, A5, A6, A7, T3, T4, T5, T6};
+const std::vector<int> callee_saved = {S0, S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11};
+
+static const char *op_names[] = {
+    "li", "la", "mv",
+    "add", "sub", "mul", "mulh", "div", "rem", "and", "or", "xor",
+    "sll", "srl", "sra", "slt", "sltu", "sgt",
+    "addi", "andi", "ori", "xori", "slli", "srli", "srai", "slti", "sltiu",
+    "seqz", "snez",
+    "lw", "sw",
+    "beq", "bne", "blt", "bge", "bltu", "bgeu", "beqz", "bnez",
+    "j", "call", "ret", "tail"
+};
+
+// 条件取反后的跳转
+static const RVOp inverse[] = {
+    RV_BNE, RV_BEQ, RV_BGE, RV_BLT, RV_BGEU, RV_BLTU, RV_BNEZ, RV_BEQZ
+};
+
+// 条件跳转的范围是 [-4096, 4094] 字节
+static const int BRANCH_RANGE = 4094;
+
+RVOp inverse_branch(RVOp op)
+{
+    return inverse[op - RV_BEQ];
+}
+
+void MInst::regs(std::vector<int> &defs, std::vector<int> &uses) const
+{
+    switch(op)
+    {
+    case RV_LI:
+    case RV_LA:
+        defs.push_back(rd);
+        break;
+    case RV_MV:
+    case RV_ADDI:
+    case RV_ANDI:
+    case RV_ORI:
+    case RV_XORI:
+    case RV_SLLI:
+    case RV_SRLI:
+    case RV_SRAI:
+    case RV_SLTI:
+    case RV_SLTIU:
+    case RV_SEQZ:
+    case RV_SNEZ:
+    case RV_LW:
+        defs.push_back(rd);
+        uses.push_back(rs1);
+        break;
+    case RV_SW:
+    case RV_BEQ:
+    case RV_BNE:
+    case RV_BLT:
+    case RV_BGE:
+    case RV_BLTU:
+    case RV_BGEU:
+        uses.push_back(rs1);
+        uses.push_back(rs2);
+        break;
+    case RV_BEQZ:
+    case RV_BNEZ:
+        uses.push_back(rs1);
+        break;
+    case RV_J:
+        break;
+    case RV_CALL:
+        for(int i = 0; i < imm; i ++)
+            uses.push_back(A0 + i);
+        defs.insert(defs.end(), caller_saved.begin(), caller_saved.end());
+        break;
+    case RV_TAIL:
+        for(int i = 0; i < imm; i ++)
+            uses.push_back(A0 + i);
+        break;
+    case RV_RET:
+        if(imm)
+            uses.push_back(A0);
+        break;
+    default:
+        defs.push_back(rd);
+        uses.push_back(rs1);
+        uses.push_back(rs2);
+        break;
+    }
+
+    return;
+}
+
+bool MInst::is_branch(void) const
+{
+    return op >= RV_BEQ && op <= RV_BNEZ;
+}
+
+bool MInst::is_terminator(void) const
+{
+    return is_branch() || op == RV_J || op == RV_RET || op == RV_TAIL;
+}
+
+MFunc::MFunc(const std::string &_name) : next_vreg(VREG), name(_name), frame({0, 0, 0, 0, 0, {}}), has_call(false), out_size(0)
+{
+    return;
+}
+
+int MFunc::vreg(void)
+{
+    return next_vreg ++;
+}
+
+int MFunc::vreg_count(void)
+{
+    return next_vreg;
+}
+
+int MFunc::object(int size, int arg)
+{
+    objects.push_back({size, arg, 0});
+
+    return objects.size() - 1;
+}
+
+std::vector<int> MFunc::succ(int b)
+{
+    std::vector<int> res;
+
+    for(auto &inst : blocks[b].insts)
+        if(inst.target != -1 && std::find(res.begin(), res.end(), inst.target) == res.end())
+            res.push_back(inst.target);
+    if(b + 1 < (int)blocks.size() && (blocks[b].insts.empty() || (blocks[b].insts.back().op != RV_J && blocks[b].insts.back().op != RV_RET && blocks[b].insts.back().op != RV_TAIL)))
+        if(std::find(res.begin(), res.end(), b + 1) == res.end())
+            res.push_back(b + 1);
+
+    return res;
+}
+
+// 指令展开后最多占用的字节数: li, la, call 和 tail 可能是两条指令, 条件跳转可能被展开为长跳转
+static int max_size(const MInst &inst)
+{
+    if(inst.op == RV_LI)
+        return inst.imm >= -2048 && inst.imm < 2048 ? 4 : 8;
+    if(inst.op == RV_LA || inst.op == RV_CALL || inst.op == RV_TAIL || inst.is_branch())
+        return 8;
+    return 4;
+}
+
+static void print_inst(MFunc &func, const MInst &inst, bool near, int &skip, Output &res)
+{
+    if(inst.rd >= VREG || inst.rs1 >= VREG || inst.rs2 >= VREG || inst.slot != -1)
+        throw std::runtime_error("error: unallocated machine instruction in " + func.name);
+
+    res << "\t";
+    switch(inst.op)
+    {
+    case RV_LI:
+        res << "li " << reg_names[inst.rd] << ", " << inst.imm;
+        break;
+    case RV_LA:
+        res << "la " << reg_names[inst.rd] << ", " << inst.sym;
+        break;
+    case RV_MV:
+    case RV_SEQZ:
+    case RV_SNEZ:
+        res << op_names[inst.op] << " " << reg_names[inst.rd] << ", " << reg_names[inst.rs1];
+        break;
+    case RV_ADDI:
+    case RV_ANDI:
+    case RV_ORI:
+    case RV_XORI:
+    case RV_SLLI:
+    case RV_SRLI:
+    case RV_SRAI:
+    case RV_SLTI:
+    case RV_SLTIU:
+        res << op_names[inst.op] << " " << reg_names[inst.rd] << ", " << reg_names[inst.rs1] << ", " << inst.imm;
+        break;
+    case RV_LW:
+        res << "lw " << reg_names[inst.rd] << ", " << inst.imm << "(" << reg_names[inst.rs1] << ")";
+        break;
+    case RV_SW:
+        res << "sw " << reg_names[inst.rs2] << ", " << inst.imm << "(" << reg_names[inst.rs1] << ")";
+        break;
+    case RV_BEQ:
+    case RV_BNE:
+    case RV_BLT:
+    case RV_BGE:
+    case RV_BLTU:
+    case RV_BGEU:
+        if(near)
+        {
+            res << op_names[inst.op] << " " << reg_names[inst.rs1] << ", " << reg_names[inst.rs2] << ", " << func.name << "_" << func.blocks[inst.target].name;
+            break;
+        }
+        res << op_names[inverse[inst.op - RV_BEQ]] << " " << reg_names[inst.rs1] << ", " << reg_names[inst.rs2] << ", " << func.name << "_skip" << skip << "\n";
+        res << "\tj " << func.name << "_" << func.blocks[inst.target].name << "\n";
+        res << func.name << "_skip" << skip ++ << ":";
+        break;
+    case RV_BEQZ:
+    case RV_BNEZ:
+        if(near)
+        {
+            res << op_names[inst.op] << " " << reg_names[inst.rs1] << ", " << func.name << "_" << func.blocks[inst.target].name;
+            break;
+        }
+        res << op_names[inverse[inst.op - RV_BEQ]] << " " << reg_names[inst.rs1] << ", " << func.name << "_skip" << skip << "\n";
+        res << "\tj " << func.name << "_" << func.blocks[inst.target].name << "\n";
+        res << func.name << "_skip" << skip ++ << ":";
+        break;
+    case RV_J:
+        res << "j " << func.name << "_" << func.blocks[inst.target].name;
+        break;
+    case RV_CALL:
+    case RV_TAIL:
+        res << op_names[inst.op] << " " << inst.sym;
+        break;
+    case RV_RET:
+        res << "ret";
+        break;
+    default:
+        res << op_names[inst.op] << " " << reg_names[inst.rd] << ", " << reg_names[inst.rs1] << ", " << reg_names[inst.rs2];
+        break;
+    }
+    res << "\n";
+
+    return;
+}
+
+void print_func(MFunc &func, Output &res)
+{
+    int skip = 0, pos = 0;
+    std::vector<int> start;
+
+    // 按最大长度估计每个块的位置, 目标在范围内的条件跳转直接输出, 否则展开为长跳转
+    for(auto &blk : func.blocks)
+    {
+        start.push_back(pos);
+        for(auto &inst : blk.insts)
+            pos += max_size(inst);
+    }
+
+    res << ".globl " << func.name << "\n";
+    res << func.name << ":\n";
+    pos = 0;
+    for(auto &blk : func.blocks)
+    {
+        res << "\n" << func.name << "_" << blk.name << ":\n";
+        for(auto &inst : blk.insts)
+        {
+            print_inst(func, inst, inst.is_branch() && std::abs(start[inst.target] - pos) <= BRANCH_RANGE, skip, res);
+            pos += max_size(inst);
+        }
+    }
+
+    return;
+}
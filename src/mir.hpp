@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "output.hpp"
+
+// 物理寄存器按 RISC-V 的编号, 虚拟寄存器从 VREG 开始编号
+enum Reg
+{
+    ZERO, RA, SP, GP, TP, T0, T1, T2, S0, S1,
+    A0, A1, A2, A3, A4, A5, A6, A7,
+    S2, S3, S4, S5, S6, S7, S8, S9, S10, S11,
+    T3, T4, T5, T6,
+    VREG
+};
+
+enum RVOp
+{
+    RV_LI, RV_LA, RV_MV,
+    RV_ADD, RV_SUB, RV_MUL, RV_MULH, RV_DIV, RV_REM, RV_AND, RV_OR, RV_XOR,
+    RV_SLL, RV_SRL, RV_SRA, RV_SLT, RV_SLTU, RV_SGT,
+    RV_ADDI, RV_ANDI, RV_ORI, RV_XORI, RV_SLLI, RV_SRLI, RV_SRAI, RV_SLTI, RV_SLTIU,
+    RV_SEQZ, RV_SNEZ,
+    RV_LW, RV_SW,
+    RV_BEQ, RV_BNE, RV_BLT, RV_BGE, RV_BLTU, RV_BGEU, RV_BEQZ, RV_BNEZ,
+    RV_J, RV_CALL, RV_RET, RV_TAIL
+};
+
+// 一条机器指令: 访存指令的地址为 imm(rs1), slot 不为 -1 时再加上栈上对象 slot 的位置
+// 跳转的目标是基本块编号 target; call 和 tail 的 imm 是放在寄存器中的参数个数, ret 的 imm 表示是否有返回值
+// tail 是尾调用: 恢复栈帧后直接跳转到被调函数, 由它返回到当前函数的调用者
+struct MInst
+{
+    RVOp op;
+    int rd, rs1, rs2, imm, slot, target;
+    const char *sym;
+
+    MInst(RVOp _op, int _rd = -1, int _rs1 = -1, int _rs2 = -1, int _imm = 0) : op(_op), rd(_rd), rs1(_rs1), rs2(_rs2), imm(_imm), slot(-1), target(-1), sym(nullptr)
+    {
+        return;
+    }
+
+    void regs(std::vector<int> &defs, std::vector<int> &uses) const;
+    bool is_branch(void) const;
+    bool is_terminator(void) const;
+};
+
+struct MBlock
+{
+    std::string name;
+    std::vector<MInst> insts;
+};
+
+// 栈上对象: 局部变量, 溢出的值, 或者第 arg 个通过栈传入的参数
+struct FrameObject
+{
+    int size, arg, offset;
+};
+
+// 栈帧布局, 每个函数在 lower_frame 中计算一次
+// 自顶向下依次为 ra 和被调用者保存寄存器, 局部数组, 标量和溢出的值共用的栈槽, 传给被调函数的栈上参数
+// saved, locals, slots 是各区域底部相对 sp 的偏移量, 传出参数区从 0 开始
+// 序言放在 entry 块的开头, 尾声放在从 entry 能到达的 ret 和 tail 之前
+struct Frame
+{
+    int size, saved, locals, slots, entry;
+    std::vector<int> regs;
+};
+
+// 一个函数的机器代码
+class MFunc
+{
+private:
+    int next_vreg;
+
+public:
+    std::string name;
+    std::vector<MBlock> blocks;
+    std::vector<FrameObject> objects;
+    Frame frame;
+    bool has_call;
+    int out_size;
+
+    MFunc(const std::string &_name);
+
+    int vreg(void);
+    int vreg_count(void);
+    int object(int size, int arg = -1);
+    std::vector<int> succ(int b);
+};
+
+extern const char *reg_names[VREG];
+extern const std::vector<int> caller_saved, callee_saved;
+
+RVOp inverse_branch(RVOp op);
+
+void print_func(MFunc &func, Output &res);
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "output.hpp"
+
+Output::Output(void) : fd(-1), echo(false), async(false), done(false)
+{
+    return;
+}
+
+Output::Output(const char *_path, bool _echo, bool _async) : path(_path), echo(_echo), async(_async), done(false)
+{
+    // 设备和管道不能改名替换, 直接写入
+    struct stat st;
+    if(stat(_path, &st) == 0 && !S_ISREG(st.st_mode))
+        fd = open(_path, O_WRONLY | O_TRUNC);
+    else
+    {
+        temp = path + ".tmp";
+        fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if(fd < 0)
+        throw std::runtime_error("error: cannot open " + path);
+    chunk.reserve(CHUNK_SIZE);
+    if(async)
+        worker = std::thread(&Output::work, this);
+
+    return;
+}
+
+Output::~Output(void)
+{
+    finish(false);
+
+    return;
+}
+
+void Output::write_chunk(const std::vector<char> &buf)
+{
+    for(size_t pos = 0; pos < buf.size(); )
+    {
+        ssize_t n = write(fd, buf.data() + pos, buf.size() - pos);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            throw std::runtime_error("error: cannot write output");
+        pos += n;
+    }
+    if(echo)
+        for(size_t pos = 0; pos < buf.size(); )
+        {
+            ssize_t n = write(STDOUT_FILENO, buf.data() + pos, buf.size() - pos);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n < 0)
+                break;
+            pos += n;
+        }
+
+    return;
+}
+
+void Output::flush_chunk(void)
+{
+    if(chunk.empty())
+        return;
+
+    if(fd < 0)
+    {
+        pending.push_back(std::move(chunk));
+        chunk.clear();
+        return;
+    }
+    if(async)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        cond.wait(guard, [this]{ return pending.size() < MAX_PENDING; });
+        pending.push_back(std::move(chunk));
+        cond.notify_all();
+    }
+    else
+        write_chunk(chunk);
+
+    chunk.clear();
+    chunk.reserve(CHUNK_SIZE);
+
+    return;
+}
+
+void Output::work(void)
+{
+    while(true)
+    {
+        std::vector<char> buf;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cond.wait(guard, [this]{ return done || !pending.empty(); });
+            if(pending.empty())
+                return;
+            buf = std::move(pending.front());
+            pending.pop_front();
+            cond.notify_all();
+            if(error)
+                continue;
+        }
+        // 出错之后继续取出剩下的块, 写入线程不能让等待空位的调用者阻塞
+        try
+        {
+            write_chunk(buf);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            error = std::current_exception();
+        }
+    }
+}
+
+void Output::close(void)
+{
+    finish(true);
+
+    return;
+}
+
+// 结束后台线程并关闭文件, keep 为 true 时保留输出并报告第一个错误, 否则丢弃输出
+void Output::finish(bool keep)
+{
+    if(fd < 0)
+        return;
+
+    // 无论写入是否出错都要结束后台线程并关闭文件, 之后再报告第一个错误
+    std::exception_ptr res;
+    try
+    {
+        if(keep)
+            flush_chunk();
+    }
+    catch(...)
+    {
+        res = std::current_exception();
+    }
+    if(async)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            done = true;
+            cond.notify_all();
+        }
+        worker.join();
+        if(!res)
+            res = error;
+    }
+    ::close(fd);
+    fd = -1;
+    if(!temp.empty())
+    {
+        if(keep && !res && rename(temp.c_str(), path.c_str()) < 0)
+            res = std::make_exception_ptr(std::runtime_error("error: cannot write " + path));
+        if(!keep || res)
+            unlink(temp.c_str());
+    }
+    if(keep && res)
+        std::rethrow_exception(res);
+
+    return;
+}
+
+void Output::append(const char *s, size_t len)
+{
+    while(len)
+    {
+        size_t n = std::min(len, CHUNK_SIZE - chunk.size());
+        chunk.insert(chunk.end(), s, s + n);
+        s += n;
+        len -= n;
+        if(chunk.size() == CHUNK_SIZE)
+            flush_chunk();
+    }
+
+    return;
+}
+
+void Output::splice(Output &other)
+{
+    for(auto &buf : other.pending)
+        append(buf.data(), buf.size());
+    append(other.chunk.data(), other.chunk.size());
+    other.pending.clear();
+    other.chunk.clear();
+
+    return;
+}
+
+Output &Output::operator<<(const char *s)
+{
+    append(s, strlen(s));
+
+    return *this;
+}
+
+Output &Output::operator<<(const std::string &s)
+{
+    append(s.data(), s.size());
+
+    return *this;
+}
+
+Output &Output::operator<<(char c)
+{
+    append(&c, 1);
+
+    return *this;
+}
+
+Output &Output::operator<<(int x)
+{
+    char buf[24];
+    append(buf, std::to_chars(buf, buf + sizeof(buf), x).ptr - buf);
+
+    return *this;
+}
+
+Output &Output::operator<<(unsigned long x)
+{
+    char buf[24];
+    append(buf, std::to_chars(buf, buf + sizeof(buf), x).ptr - buf);
+
+    return *this;
+}
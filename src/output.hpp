@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 分块输出缓冲: 写满一块就整块写入文件 (可选由后台线程写入), 不保留整个程序的副本
+// 不指定文件时只在内存中缓冲, 之后用 splice 按顺序拼接到另一个 Output
+// 后台线程遇到的写入错误记在 error 中, 由 close 在调用者的线程上抛出
+// 普通文件先写到 path.tmp, close 成功后才改名为 path; 没有 close 就析构或者写入出错时删除临时文件, 不留下不完整的输出
+class Output
+{
+private:
+    static const size_t CHUNK_SIZE = 1U << 20;
+    static const size_t MAX_PENDING = 8;
+
+    int fd;
+    std::string path, temp;
+    bool echo, async, done;
+    std::vector<char> chunk;
+    std::deque<std::vector<char>> pending;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::thread worker;
+    std::exception_ptr error;
+
+    void write_chunk(const std::vector<char> &buf);
+    void flush_chunk(void);
+    void work(void);
+    void finish(bool keep);
+
+public:
+    Output(void);
+    Output(const char *path, bool _echo = false, bool _async = false);
+    ~Output(void);
+
+    void append(const char *s, size_t len);
+    void splice(Output &other);
+    void close(void);
+
+    Output &operator<<(const char *s);
+    Output &operator<<(const std::string &s);
+    Output &operator<<(char c);
+    Output &operator<<(int x);
+    Output &operator<<(unsigned long x);
+};
@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "mir.hpp"
+#include "peephole.hpp"
+
+static const char *rule_name[] = {"store-to-load forwarding", "redundant load", "dead definition", "compare-branch fusion", "algebraic identity", "copy forwarding"};
+
+// 物理寄存器集合用位掩码表示; ret 和 tail 还要保留 ra, sp 和被调用者保存寄存器, call 会读 sp 上的参数
+static void reg_masks(const MInst &inst, unsigned &defs, unsigned &uses)
+{
+    std::vector<int> d, u;
+
+    inst.regs(d, u);
+    defs = uses = 0;
+    for(int r : d)
+        defs |= 1U << r;
+    for(int r : u)
+        uses |= 1U << r;
+    if(inst.op == RV_CALL)
+        uses |= 1U << SP;
+    if(inst.op == RV_RET || inst.op == RV_TAIL)
+    {
+        uses |= 1U << RA | 1U << SP;
+        for(int r : callee_saved)
+            uses |= 1U << r;
+    }
+    defs &= ~(1U << ZERO);
+    uses &= ~(1U << ZERO);
+
+    return;
+}
+
+static bool is_pure(const MInst &inst)
+{
+    return inst.op != RV_SW && inst.op != RV_CALL && inst.op != RV_RET && inst.op != RV_TAIL && inst.op != RV_J && !inst.is_branch();
+}
+
+static std::vector<unsigned> live_out(MFunc &func)
+{
+    int n = func.blocks.size();
+    std::vector<unsigned> in(n, 0), out(n, 0);
+    std::vector<std::vector<int>> succ(n);
+
+    for(int b = 0; b < n; b ++)
+        succ[b] = func.succ(b);
+    for(bool changed = true; changed; )
+    {
+        changed = false;
+        for(int b = n - 1; b >= 0; b --)
+        {
+            unsigned live = 0;
+            for(int s : succ[b])
+                live |= in[s];
+            out[b] = live;
+            for(int i = (int)func.blocks[b].insts.size() - 1; i >= 0; i --)
+            {
+                unsigned defs, uses;
+                reg_masks(func.blocks[b].insts[i], defs, uses);
+                live = (live & ~defs) | uses;
+            }
+            if(live != in[b])
+            {
+                in[b] = live;
+                changed = true;
+            }
+        }
+    }
+
+    return out;
+}
+
+Peephole::Peephole(void)
+{
+    std::fill(removed, removed + RULE_COUNT, 0);
+
+    return;
+}
+
+// 顺序扫描: 记录寄存器中的常量和内存中的值, 做代数化简, 把 load 换成已有的值
+// 栈上对象还没有换成偏移量, 地址由基址, 偏移量和对象一起确定
+bool Peephole::forward(MBlock &blk, long *count)
+{
+    struct Memory
+    {
+        int base, offset, slot, reg;
+        bool load;
+    };
+
+    bool changed = false, known[VREG] = {true};
+    int value[VREG] = {0};
+    std::vector<Memory> memory;
+    std::vector<MInst> insts;
+
+    auto is_const = [&](int r, int v)
+    {
+        return known[r] && value[r] == v;
+    };
+
+    for(auto inst : blk.insts)
+    {
+        MInst orig = inst;
+        bool drop = false;
+        switch(inst.op)
+        {
+        case RV_ADD:
+        case RV_OR:
+        case RV_XOR:
+            if(is_const(inst.rs1, 0))
+                inst = MInst(RV_MV, inst.rd, inst.rs2);
+            else if(is_const(inst.rs2, 0))
+                inst = MInst(RV_MV, inst.rd, inst.rs1);
+            break;
+        case RV_SUB:
+        case RV_SLL:
+        case RV_SRL:
+        case RV_SRA:
+            if(is_const(inst.rs2, 0))
+                inst = MInst(RV_MV, inst.rd, inst.rs1);
+            break;
+        case RV_AND:
+            if(is_const(inst.rs1, 0) || is_const(inst.rs2, 0))
+                inst = MInst(RV_MV, inst.rd, ZERO);
+            break;
+        case RV_MUL:
+            if(is_const(inst.rs1, 0) || is_const(inst.rs2, 0))
+                inst = MInst(RV_MV, inst.rd, ZERO);
+            else if(is_const(inst.rs1, 1))
+                inst = MInst(RV_MV, inst.rd, inst.rs2);
+            else if(is_const(inst.rs2, 1))
+                inst = MInst(RV_MV, inst.rd, inst.rs1);
+            break;
+        case RV_DIV:
+            if(is_const(inst.rs2, 1))
+                inst = MInst(RV_MV, inst.rd, inst.rs1);
+            break;
+        case RV_REM:
+            if(is_const(inst.rs2, 1))
+                inst = MInst(RV_MV, inst.rd, ZERO);
+            break;
+        case RV_ADDI:
+        case RV_ORI:
+        case RV_XORI:
+        case RV_SLLI:
+        case RV_SRLI:
+        case RV_SRAI:
+            if(!inst.imm && inst.slot == -1)
+                inst = MInst(RV_MV, inst.rd, inst.rs1);
+            break;
+        case RV_ANDI:
+            if(!inst.imm)
+                inst = MInst(RV_MV, inst.rd, ZERO);
+            break;
+        case RV_LI:
+            if(is_const(inst.rd, inst.imm))
+            {
+                count[REDUNDANT_LOAD] ++;
+                drop = true;
+            }
+            break;
+        case RV_LW:
+            for(auto &mem : memory)
+                if(mem.base == inst.rs1 && mem.offset == inst.imm && mem.slot == inst.slot)
+                {
+                    if(mem.reg == inst.rd)
+                    {
+                        count[mem.load ? REDUNDANT_LOAD : STORE_LOAD] ++;
+                        drop = true;
+                    }
+                    else
+                        inst = MInst(RV_MV, inst.rd, mem.reg);
+                    break;
+                }
+            break;
+        default:
+            break;
+        }
+        if(inst.op == RV_MV && inst.rd == inst.rs1)
+        {
+            count[ALGEBRAIC] ++;
+            drop = true;
+        }
+        if(drop)
+        {
+            changed = true;
+            continue;
+        }
+        if(inst.op != orig.op || inst.rs1 != orig.rs1 || inst.rs2 != orig.rs2)
+            changed = true;
+
+        unsigned defs, uses;
+        reg_masks(inst, defs, uses);
+        for(int r = 0; r < VREG; r ++)
+            if(defs >> r & 1)
+                known[r] = false;
+        memory.erase(std::remove_if(memory.begin(), memory.end(), [&](const Memory &mem)
+        {
+            return (defs >> mem.reg & 1) || (defs >> mem.base & 1);
+        }), memory.end());
+
+        if(inst.op == RV_LI)
+        {
+            known[inst.rd] = true;
+            value[inst.rd] = inst.imm;
+        }
+        else if(inst.op == RV_MV && known[inst.rs1])
+        {
+            known[inst.rd] = true;
+            value[inst.rd] = value[inst.rs1];
+        }
+        else if(inst.op == RV_LW && inst.rs1 != inst.rd)
+            memory.push_back({inst.rs1, inst.imm, inst.slot, inst.rd, true});
+        else if(inst.op == RV_SW)
+        {
+            // 栈上的标量不会被指针访问到, 通过其他寄存器的写入则可能写到任何地方
+            memory.erase(std::remove_if(memory.begin(), memory.end(), [&](const Memory &mem)
+            {
+                return inst.rs1 != SP || mem.base != SP || (mem.offset == inst.imm && mem.slot == inst.slot);
+            }), memory.end());
+            memory.push_back({inst.rs1, inst.imm, inst.slot, inst.rs2, false});
+        }
+        else if(inst.op == RV_CALL)
+            memory.clear();
+        insts.push_back(inst);
+    }
+    blk.insts.swap(insts);
+
+    return changed;
+}
+
+static bool uses_reg(const MInst &inst, int r)
+{
+    unsigned defs, uses;
+
+    reg_masks(inst, defs, uses);
+
+    return uses >> r & 1;
+}
+
+static bool defs_reg(const MInst &inst, int r)
+{
+    unsigned defs, uses;
+
+    reg_masks(inst, defs, uses);
+
+    return defs >> r & 1;
+}
+
+// 在窗口内做比较与跳转的合并, 以及前向/后向的复制传播
+bool Peephole::window(MBlock &blk, unsigned live_out, long *count)
+{
+    auto &insts = blk.insts;
+    int n = insts.size();
+    bool changed = false;
+    std::vector<unsigned> live(n);
+    std::vector<bool> gone(n, false);
+
+    // live[i] 为第 i 条指令之后活跃的寄存器; 向前的复制传播会改变后面的指令, 改写后要更新 [i, k) 的活跃信息
+    unsigned cur = live_out;
+    for(int i = n - 1; i >= 0; i --)
+    {
+        unsigned defs, uses;
+        live[i] = cur;
+        reg_masks(insts[i], defs, uses);
+        cur = (cur & ~defs) | uses;
+    }
+
+    // 在 [from, to) 中没有删除的指令里找 r 的使用或者定义
+    auto used_between = [&](int from, int to, int r)
+    {
+        for(int k = from; k < to; k ++)
+            if(!gone[k] && uses_reg(insts[k], r))
+                return true;
+        return false;
+    };
+    auto defined_between = [&](int from, int to, int r)
+    {
+        for(int k = from; k < to; k ++)
+            if(!gone[k] && defs_reg(insts[k], r))
+                return true;
+        return false;
+    };
+    // 向前找 r 最近的定义
+    auto find_def = [&](int i, int r)
+    {
+        for(int j = i - 1; j >= 0 && j >= i - WINDOW; j --)
+            if(!gone[j] && defs_reg(insts[j], r))
+                return j;
+        return -1;
+    };
+    auto is_bool = [&](int i, int r)
+    {
+        int j = find_def(i, r);
+        if(j == -1)
+            return false;
+        RVOp op = insts[j].op;
+        return op == RV_SLT || op == RV_SLTU || op == RV_SGT || op == RV_SLTI || op == RV_SLTIU || op == RV_SEQZ || op == RV_SNEZ;
+    };
+
+    for(int i = 0; i < n; i ++)
+    {
+        auto &inst = insts[i];
+        if(gone[i])
+            continue;
+
+        if((inst.op == RV_BNEZ || inst.op == RV_BEQZ) && inst.rs1 != ZERO)
+        {
+            int t = inst.rs1, j = find_def(i, t);
+            if(j == -1 || (live[i] >> t & 1) || used_between(j + 1, i, t))
+                continue;
+            auto &def = insts[j];
+            if(defined_between(j + 1, i, def.rs1) || (def.rs2 != -1 && defined_between(j + 1, i, def.rs2)))
+                continue;
+
+            bool nez = inst.op == RV_BNEZ;
+            MInst res = inst;
+            switch(def.op)
+            {
+            case RV_SEQZ:
+                res = MInst(nez ? RV_BEQZ : RV_BNEZ, -1, def.rs1);
+                break;
+            case RV_SNEZ:
+                res = MInst(inst.op, -1, def.rs1);
+                break;
+            case RV_XORI:
+                if(def.imm != 1 || !is_bool(j, def.rs1))
+                    continue;
+                res = MInst(nez ? RV_BEQZ : RV_BNEZ, -1, def.rs1);
+                break;
+            case RV_SLT:
+                res = MInst(nez ? RV_BLT : RV_BGE, -1, def.rs1, def.rs2);
+                break;
+            case RV_SGT:
+                res = MInst(nez ? RV_BLT : RV_BGE, -1, def.rs2, def.rs1);
+                break;
+            case RV_SLTU:
+                res = MInst(nez ? RV_BLTU : RV_BGEU, -1, def.rs1, def.rs2);
+                break;
+            case RV_XOR:
+            case RV_SUB:
+                res = MInst(nez ? RV_BNE : RV_BEQ, -1, def.rs1, def.rs2);
+                break;
+            default:
+                continue;
+            }
+            res.target = inst.target;
+            inst = res;
+            gone[j] = true;
+            count[BRANCH_FUSION] ++;
+            changed = true;
+        }
+        else if(inst.op == RV_MV)
+        {
+            int t = inst.rd, a = inst.rs1;
+
+            // mv t, a 之后 t 只在一条指令中使用: 直接读 a
+            int k = i + 1;
+            while(k < n && k <= i + WINDOW && (gone[k] || !uses_reg(insts[k], t)))
+                k ++;
+            if(k < n && k <= i + WINDOW && insts[k].op != RV_CALL && insts[k].op != RV_RET && insts[k].op != RV_TAIL
+                && (!(live[k] >> t & 1) || defs_reg(insts[k], t))
+                && !defined_between(i + 1, k, t) && !defined_between(i + 1, k, a))
+            {
+                if(insts[k].rs1 == t)
+                    insts[k].rs1 = a;
+                if(insts[k].rs2 == t)
+                    insts[k].rs2 = a;
+                for(int j = i; j < k; j ++)
+                {
+                    live[j] &= ~(1U << t);
+                    if(a != ZERO)
+                        live[j] |= 1U << a;
+                }
+                gone[i] = true;
+                count[COPY] ++;
+                changed = true;
+                continue;
+            }
+
+            // op t, ...; mv rd, t: 直接写入 rd
+            int j = find_def(i, a);
+            if(j == -1 || a == ZERO || t == ZERO || (live[i] >> a & 1))
+                continue;
+            auto &def = insts[j];
+            if(!is_pure(def) || def.rd != a || used_between(j + 1, i, a) || used_between(j + 1, i, t) || defined_between(j + 1, i, t))
+                continue;
+            def.rd = t;
+            gone[i] = true;
+            count[COPY] ++;
+            changed = true;
+        }
+    }
+
+    if(changed)
+    {
+        std::vector<MInst> res;
+        for(int i = 0; i < n; i ++)
+            if(!gone[i])
+                res.push_back(insts[i]);
+        insts.swap(res);
+    }
+
+    return changed;
+}
+
+// 逆序扫描, 删除结果不再使用的无副作用指令
+bool Peephole::sweep(MBlock &blk, unsigned live_out, long *count)
+{
+    auto &insts = blk.insts;
+    unsigned live = live_out;
+    bool changed = false;
+    std::vector<MInst> res;
+
+    for(int i = (int)insts.size() - 1; i >= 0; i --)
+    {
+        unsigned defs, uses;
+        reg_masks(insts[i], defs, uses);
+        if(is_pure(insts[i]) && !(defs & live))
+        {
+            count[DEAD_DEF] ++;
+            changed = true;
+            continue;
+        }
+        live = (live & ~defs) | uses;
+        res.push_back(insts[i]);
+    }
+    if(changed)
+    {
+        std::reverse(res.begin(), res.end());
+        insts.swap(res);
+    }
+
+    return changed;
+}
+
+void Peephole::run(MFunc &func)
+{
+    long count[RULE_COUNT] = {0};
+
+    for(bool changed = true; changed; )
+    {
+        changed = false;
+        for(auto &blk : func.blocks)
+            changed |= forward(blk, count);
+        auto out = live_out(func);
+        for(int b = 0; b < (int)func.blocks.size(); b ++)
+            changed |= window(func.blocks[b], out[b], count);
+        out = live_out(func);
+        for(int b = 0; b < (int)func.blocks.size(); b ++)
+            changed |= sweep(func.blocks[b], out[b], count);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    for(int i = 0; i < RULE_COUNT; i ++)
+        removed[i] += count[i];
+
+    return;
+}
+
+void Peephole::report(std::ostream &os)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for(int i = 0; i < RULE_COUNT; i ++)
+        os << "peephole: " << rule_name[i] << " removed " << removed[i] << " instructions\n";
+
+    return;
+}
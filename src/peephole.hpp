@@ -0,0 +1,37 @@
+#pragma once
+
+#include <mutex>
+#include <ostream>
+#include "mir.hpp"
+
+// 寄存器分配之后, 确定栈帧之前的窥孔优化, 统计每条规则删掉的指令数
+class Peephole
+{
+public:
+    enum Rule
+    {
+        STORE_LOAD,
+        REDUNDANT_LOAD,
+        DEAD_DEF,
+        BRANCH_FUSION,
+        ALGEBRAIC,
+        COPY,
+        RULE_COUNT
+    };
+
+private:
+    static const int WINDOW = 8;
+
+    std::mutex lock;
+    long removed[RULE_COUNT];
+
+    bool forward(MBlock &blk, long *count);
+    bool window(MBlock &blk, unsigned live_out, long *count);
+    bool sweep(MBlock &blk, unsigned live_out, long *count);
+
+public:
+    Peephole(void);
+
+    void run(MFunc &func);
+    void report(std::ostream &os);
+};
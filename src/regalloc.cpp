@@ -0,0 +1,611 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "cfg.hpp"
+#include "mir.hpp"
+#include "regalloc.hpp"
+
+LinearScan::LinearScan(int _precolored, const std::vector<int> &_caller, const std::vector<int> &_callee) : precolored(_precolored), caller(_caller), callee(_callee)
+{
+    return;
+}
+
+void LinearScan::reserve(int reg, int from, int to)
+{
+    if(reg >= (int)ranges.size())
+        ranges.resize(reg + 1);
+    ranges[reg].push_back({from, to});
+
+    return;
+}
+
+// 通过 mv 相连的寄存器: 物理寄存器, 或者已经分配过的虚拟寄存器所在的寄存器会被优先选择, 复制就可以删掉
+void LinearScan::hint(int vreg, int reg)
+{
+    if(vreg >= (int)hints.size())
+        hints.resize(vreg + 1);
+    hints[vreg].push_back(reg);
+
+    return;
+}
+
+bool LinearScan::conflict(int reg, const Interval &it)
+{
+    if(reg >= precolored)
+        return false;
+
+    // 每个寄存器的活跃范围已合并为按位置排序且互不相交, 区间中间不活跃的空洞可以放下物理寄存器的固定区间
+    auto &fixed = ranges[reg];
+    for(auto &range : ranges[it.vreg])
+    {
+        auto pos = std::lower_bound(fixed.begin(), fixed.end(), range.first, [](const std::pair<int, int> &r, int x)
+        {
+            return r.second < x;
+        });
+        if(pos != fixed.end() && pos->first <= range.second)
+            return true;
+    }
+
+    return false;
+}
+
+void LinearScan::build(const std::vector<Block> &blocks, int vregs)
+{
+    int n = blocks.size(), words = (vregs + 63) / 64;
+    std::vector<std::vector<uint64_t>> gen(n, std::vector<uint64_t>(words)), kill = gen, live_in = gen, live_out = gen;
+    std::vector<int> first(n);
+
+    // 第 k 条指令在 4k 读取操作数, 在 4k + 2 写入结果
+    for(int b = 0, k = 0; b < n; b ++)
+    {
+        first[b] = k;
+        for(auto &inst : blocks[b].insts)
+        {
+            for(int v : inst.uses)
+                if(!(kill[b][v / 64] >> (v % 64) & 1))
+                    gen[b][v / 64] |= 1ULL << (v % 64);
+            for(int v : inst.defs)
+                kill[b][v / 64] |= 1ULL << (v % 64);
+            k ++;
+        }
+    }
+
+    // 活跃变量分析
+    for(bool changed = true; changed; )
+    {
+        changed = false;
+        for(int b = n - 1; b >= 0; b --)
+        {
+            for(int s : blocks[b].succ)
+                for(int w = 0; w < words; w ++)
+                    live_out[b][w] |= live_in[s][w];
+            for(int w = 0; w < words; w ++)
+            {
+                uint64_t in = gen[b][w] | (live_out[b][w] & ~kill[b][w]);
+                if(in != live_in[b][w])
+                {
+                    live_in[b][w] = in;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // 在每个基本块内逆序扫描, 得到每个寄存器准确的活跃范围
+    ranges.assign(vregs, {});
+    std::vector<int> live(vregs, -1);
+    for(int b = 0; b < n; b ++)
+    {
+        int begin = 4 * first[b], end = 4 * (first[b] + (int)blocks[b].insts.size()) - 1;
+        for(int r = 0; r < vregs; r ++)
+            live[r] = live_out[b][r / 64] >> (r % 64) & 1 ? end : -1;
+        for(int i = (int)blocks[b].insts.size() - 1; i >= 0; i --)
+        {
+            int pos = 4 * (first[b] + i);
+            for(int r : blocks[b].insts[i].defs)
+            {
+                reserve(r, pos + 2, std::max(pos + 2, live[r]));
+                live[r] = -1;
+            }
+            for(int r : blocks[b].insts[i].uses)
+                if(live[r] == -1)
+                    live[r] = pos;
+        }
+        for(int r = 0; r < vregs; r ++)
+            if(live[r] != -1)
+                reserve(r, begin, live[r]);
+    }
+    for(auto &list : ranges)
+    {
+        std::sort(list.begin(), list.end());
+        std::vector<std::pair<int, int>> merged;
+        for(auto &range : list)
+            if(!merged.empty() && range.first <= merged.back().second + 1)
+                merged.back().second = std::max(merged.back().second, range.second);
+            else
+                merged.push_back(range);
+        list.swap(merged);
+    }
+
+    // 每个虚拟寄存器的活跃区间取覆盖全部活跃位置的最小区间, 权重按循环深度放大
+    intervals.assign(vregs, {0, INT_MAX, -1, 0});
+    for(int v = 0; v < vregs; v ++)
+        intervals[v].vreg = v;
+    auto extend = [&](int v, int pos)
+    {
+        intervals[v].start = std::min(intervals[v].start, pos);
+        intervals[v].end = std::max(intervals[v].end, pos);
+    };
+    for(int b = 0; b < n; b ++)
+    {
+        int begin = 4 * first[b], end = 4 * (first[b] + (int)blocks[b].insts.size()) - 1;
+        double weight = std::pow(10.0, std::min(blocks[b].depth, 8));
+        for(int v = 0; v < vregs; v ++)
+        {
+            if(live_in[b][v / 64] >> (v % 64) & 1)
+                extend(v, begin);
+            if(live_out[b][v / 64] >> (v % 64) & 1)
+                extend(v, end);
+        }
+        for(int i = 0; i < (int)blocks[b].insts.size(); i ++)
+        {
+            for(int v : blocks[b].insts[i].uses)
+            {
+                extend(v, 4 * (first[b] + i));
+                intervals[v].weight += weight;
+            }
+            for(int v : blocks[b].insts[i].defs)
+            {
+                extend(v, 4 * (first[b] + i) + 2);
+                intervals[v].weight += weight;
+            }
+        }
+    }
+
+    return;
+}
+
+std::vector<LinearScan::Interval> LinearScan::sorted(void)
+{
+    std::vector<Interval> order;
+    for(auto &it : intervals)
+        if(it.vreg >= precolored && it.end != -1)
+            order.push_back(it);
+    std::sort(order.begin(), order.end(), [](const Interval &a, const Interval &b)
+    {
+        return a.start < b.start || (a.start == b.start && a.vreg < b.vreg);
+    });
+
+    return order;
+}
+
+// 按给定的顺序合并 mv 的两端, 合并后的活跃范围是两者的并, 返回每个寄存器合并到的寄存器
+std::vector<int> LinearScan::coalesce(const std::vector<Block> &blocks, int vregs, const std::vector<std::pair<int, int>> &moves)
+{
+    build(blocks, vregs);
+
+    std::vector<int> leader(vregs);
+    for(int v = 0; v < vregs; v ++)
+        leader[v] = v;
+    auto find = [&](int v)
+    {
+        while(leader[v] != v)
+            v = leader[v] = leader[leader[v]];
+        return v;
+    };
+    auto overlap = [](const std::vector<std::pair<int, int>> &a, const std::vector<std::pair<int, int>> &b)
+    {
+        for(int i = 0, j = 0; i < (int)a.size() && j < (int)b.size(); )
+            if(a[i].second < b[j].first)
+                i ++;
+            else if(b[j].second < a[i].first)
+                j ++;
+            else
+                return true;
+        return false;
+    };
+
+    for(auto &[x, y] : moves)
+    {
+        int a = find(x), b = find(y);
+        if(a == b || a < precolored || b < precolored || overlap(ranges[a], ranges[b]))
+            continue;
+        std::vector<std::pair<int, int>> merged(ranges[a].size() + ranges[b].size());
+        std::merge(ranges[a].begin(), ranges[a].end(), ranges[b].begin(), ranges[b].end(), merged.begin());
+        ranges[a].swap(merged);
+        ranges[b].clear();
+        leader[b] = a;
+    }
+
+    std::vector<int> res(vregs);
+    for(int v = 0; v < vregs; v ++)
+        res[v] = find(v);
+
+    return res;
+}
+
+std::vector<int> LinearScan::allocate(const std::vector<Block> &blocks, int vregs)
+{
+    build(blocks, vregs);
+    auto order = sorted();
+
+    std::vector<int> res(vregs, -1), regs = caller;
+    std::vector<Interval> active;
+    std::vector<char> busy;
+    regs.insert(regs.end(), callee.begin(), callee.end());
+    for(int reg : regs)
+        if(reg >= (int)busy.size())
+            busy.resize(reg + 1, false);
+
+    for(auto &it : order)
+    {
+        for(int i = 0; i < (int)active.size(); )
+            if(active[i].end < it.start)
+            {
+                busy[res[active[i].vreg]] = false;
+                active[i] = active.back();
+                active.pop_back();
+            }
+            else
+                i ++;
+
+        int pick = -1;
+        if(it.vreg < (int)hints.size())
+            for(int h : hints[it.vreg])
+            {
+                int hint = h < precolored ? h : res[h];
+                if(hint != -1 && std::find(regs.begin(), regs.end(), hint) != regs.end() && !busy[hint] && !conflict(hint, it))
+                {
+                    pick = hint;
+                    break;
+                }
+            }
+        for(int i = 0; i < (int)regs.size() && pick == -1; i ++)
+            if(!busy[regs[i]] && !conflict(regs[i], it))
+                pick = regs[i];
+
+        // 没有空闲寄存器时, 从能让出寄存器的活跃区间中选溢出代价最小的, 代价比当前区间还小才换下它
+        if(pick == -1)
+        {
+            int victim = -1;
+            double cost = it.cost();
+            for(int i = 0; i < (int)active.size(); i ++)
+                if(active[i].cost() < cost && !conflict(res[active[i].vreg], it))
+                {
+                    victim = i;
+                    cost = active[i].cost();
+                }
+            if(victim != -1)
+            {
+                pick = res[active[victim].vreg];
+                res[active[victim].vreg] = -1;
+                active[victim] = active.back();
+                active.pop_back();
+            }
+        }
+
+        if(pick != -1)
+        {
+            res[it.vreg] = pick;
+            busy[pick] = true;
+            active.push_back(it);
+        }
+    }
+
+    return res;
+}
+
+std::vector<int> LinearScan::color(const std::vector<Block> &blocks, int vregs)
+{
+    build(blocks, vregs);
+
+    // 区间图着色: 按起点扫描, 结束的区间归还颜色, 颜色数等于同时活跃的区间数的最大值
+    std::vector<int> res(vregs, -1), spare;
+    std::vector<Interval> active;
+    int colors = 0;
+    for(auto &it : sorted())
+    {
+        for(int i = 0; i < (int)active.size(); )
+            if(active[i].end < it.start)
+            {
+                spare.push_back(res[active[i].vreg]);
+                active[i] = active.back();
+                active.pop_back();
+            }
+            else
+                i ++;
+        if(spare.empty())
+            res[it.vreg] = colors ++;
+        else
+        {
+            res[it.vreg] = spare.back();
+            spare.pop_back();
+        }
+        active.push_back(it);
+    }
+
+    return res;
+}
+
+// 可分配的寄存器: t0-t2 用于读写溢出的值, t6 用于装入超出范围的偏移量
+static const std::vector<int> alloc_caller = {T3, T4, T5, A7, A6, A5, A4, A3, A2, A1, A0};
+static const std::vector<int> alloc_callee = {S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11, S0};
+
+// 同一个全局变量的 la 合并成一条, 放在支配所有使用的块中并提到循环外, 地址可以留在寄存器里
+static void hoist_addresses(MFunc &func, CFG &cfg)
+{
+    int n = func.blocks.size();
+    std::vector<const char *> syms;
+    std::unordered_map<const char *, std::vector<int>> blocks;
+    for(int b = 0; b < n; b ++)
+        for(auto &inst : func.blocks[b].insts)
+            if(inst.op == RV_LA)
+            {
+                if(!blocks.count(inst.sym))
+                    syms.push_back(inst.sym);
+                blocks[inst.sym].push_back(b);
+            }
+
+    std::unordered_map<const char *, int> addrs;
+    for(auto sym : syms)
+    {
+        int head = cfg.dominator(blocks[sym]);
+        if(head == -1)
+            continue;
+        while(cfg.depth[head])
+            head = cfg.idom[head];
+
+        auto &insts = func.blocks[head].insts;
+        int pos = 0;
+        while(pos < (int)insts.size() && !insts[pos].is_terminator() && !(insts[pos].op == RV_LA && insts[pos].sym == sym))
+            pos ++;
+        MInst la(RV_LA, addrs[sym] = func.vreg());
+        la.sym = sym;
+        insts.insert(insts.begin() + pos, la);
+    }
+
+    std::vector<int> rename(func.vreg_count(), -1);
+    for(auto &blk : func.blocks)
+    {
+        std::vector<MInst> insts;
+        for(auto &inst : blk.insts)
+            if(inst.op == RV_LA && addrs.count(inst.sym) && inst.rd != addrs[inst.sym])
+                rename[inst.rd] = addrs[inst.sym];
+            else
+                insts.push_back(inst);
+        blk.insts.swap(insts);
+    }
+    for(auto &blk : func.blocks)
+        for(auto &inst : blk.insts)
+        {
+            if(inst.rs1 >= VREG && rename[inst.rs1] != -1)
+                inst.rs1 = rename[inst.rs1];
+            if(inst.rs2 >= VREG && rename[inst.rs2] != -1)
+                inst.rs2 = rename[inst.rs2];
+        }
+
+    return;
+}
+
+// 调用都在收缩包装的区域内时, 从区域外流入的虚拟寄存器在区域入口复制一份
+// 区域外只用原来的虚拟寄存器, 它不跨越调用, 不会占用需要保存的寄存器
+static void split_call_region(MFunc &func, CFG &cfg)
+{
+    int n = func.blocks.size();
+    std::vector<int> calls;
+    for(int b = 0; b < n; b ++)
+        for(auto &inst : func.blocks[b].insts)
+            if(inst.op == RV_CALL)
+            {
+                calls.push_back(b);
+                break;
+            }
+
+    int head = cfg.wrap(calls);
+    if(head <= 0)
+        return;
+
+    int count = func.vreg_count();
+    std::vector<char> outside(count, false), inside(count, false);
+    std::vector<int> defs, uses, rename(count, -1);
+    for(int b = 0; b < n; b ++)
+        for(auto &inst : func.blocks[b].insts)
+        {
+            defs.clear();
+            uses.clear();
+            inst.regs(defs, uses);
+            if(!cfg.dominates(head, b))
+                for(int v : defs)
+                    if(v >= VREG)
+                        outside[v] = true;
+            if(cfg.dominates(head, b))
+                for(int v : uses)
+                    if(v >= VREG)
+                        inside[v] = true;
+        }
+
+    std::vector<MInst> copies;
+    for(int v = VREG; v < count; v ++)
+        if(outside[v] && inside[v])
+        {
+            rename[v] = func.vreg();
+            copies.push_back(MInst(RV_MV, rename[v], v));
+        }
+    if(copies.empty())
+        return;
+
+    auto map = [&](int &reg)
+    {
+        if(reg >= VREG && rename[reg] != -1)
+            reg = rename[reg];
+    };
+    for(int b = 0; b < n; b ++)
+        if(cfg.dominates(head, b))
+            for(auto &inst : func.blocks[b].insts)
+            {
+                map(inst.rd);
+                map(inst.rs1);
+                map(inst.rs2);
+            }
+    auto &insts = func.blocks[head].insts;
+    insts.insert(insts.begin(), copies.begin(), copies.end());
+
+    return;
+}
+
+static std::vector<LinearScan::Block> scan_blocks(MFunc &func, CFG &cfg)
+{
+    int n = func.blocks.size();
+    std::vector<LinearScan::Block> blocks(n);
+
+    for(int b = 0; b < n; b ++)
+    {
+        blocks[b].succ = cfg.succ[b];
+        blocks[b].depth = cfg.depth[b];
+        for(auto &minst : func.blocks[b].insts)
+        {
+            LinearScan::Inst inst;
+            minst.regs(inst.defs, inst.uses);
+            blocks[b].insts.push_back(std::move(inst));
+        }
+    }
+
+    return blocks;
+}
+
+// 基本块参数在每条入边上都有一次复制, 活跃范围不相交时合并复制的两端, 循环中的复制优先
+static void coalesce_copies(MFunc &func, CFG &cfg)
+{
+    std::vector<std::pair<int, int>> moves;
+    for(int d = 8; d >= 0; d --)
+        for(int b = 0; b < (int)func.blocks.size(); b ++)
+            for(auto &inst : func.blocks[b].insts)
+                if(std::min(cfg.depth[b], 8) == d && inst.op == RV_MV && inst.rd >= VREG && inst.rs1 >= VREG)
+                    moves.push_back({inst.rd, inst.rs1});
+    if(moves.empty())
+        return;
+
+    auto leader = LinearScan(VREG).coalesce(scan_blocks(func, cfg), func.vreg_count(), moves);
+    for(auto &blk : func.blocks)
+    {
+        std::vector<MInst> insts;
+        for(auto inst : blk.insts)
+        {
+            if(inst.rd >= VREG)
+                inst.rd = leader[inst.rd];
+            if(inst.rs1 >= VREG)
+                inst.rs1 = leader[inst.rs1];
+            if(inst.rs2 >= VREG)
+                inst.rs2 = leader[inst.rs2];
+            if(inst.op != RV_MV || inst.rd != inst.rs1)
+                insts.push_back(inst);
+        }
+        blk.insts.swap(insts);
+    }
+
+    return;
+}
+
+void allocate_registers(MFunc &func)
+{
+    int n = func.blocks.size();
+    CFG cfg(n);
+
+    for(int b = 0; b < n; b ++)
+        for(int s : func.succ(b))
+            cfg.add_edge(b, s);
+    cfg.analyze();
+    hoist_addresses(func, cfg);
+    coalesce_copies(func, cfg);
+    split_call_region(func, cfg);
+    auto blocks = scan_blocks(func, cfg);
+
+    LinearScan scan(VREG, alloc_caller, alloc_callee);
+    for(auto &blk : func.blocks)
+        for(auto &inst : blk.insts)
+            if(inst.op == RV_MV)
+            {
+                if(inst.rd >= VREG)
+                    scan.hint(inst.rd, inst.rs1);
+                if(inst.rs1 >= VREG)
+                    scan.hint(inst.rs1, inst.rd);
+            }
+    auto res = scan.allocate(blocks, func.vreg_count());
+
+    // 只由一条 la 或 li 定值的虚拟寄存器溢出时不占用栈槽, 在每次使用前重新计算
+    std::vector<int> defined(func.vreg_count(), 0);
+    std::vector<MInst> source(func.vreg_count(), MInst(RV_LI));
+    for(auto &blk : func.blocks)
+        for(auto &inst : blk.insts)
+            if(inst.rd >= VREG)
+            {
+                defined[inst.rd] ++;
+                source[inst.rd] = inst;
+            }
+    auto remat = [&](int v)
+    {
+        return defined[v] == 1 && (source[v].op == RV_LA || source[v].op == RV_LI);
+    };
+
+    // 把虚拟寄存器换成分配到的物理寄存器, 溢出的值在使用前读到临时寄存器, 定值后写回栈上
+    std::vector<int> slots(func.vreg_count(), -1);
+    auto slot = [&](int v)
+    {
+        if(slots[v] == -1)
+            slots[v] = func.object(4);
+        return slots[v];
+    };
+    auto reload = [&](std::vector<MInst> &insts, int v, int tmp)
+    {
+        if(remat(v))
+        {
+            insts.push_back(source[v]);
+            insts.back().rd = tmp;
+        }
+        else
+            insts.emplace_back(RV_LW, tmp, SP).slot = slot(v);
+    };
+    for(auto &blk : func.blocks)
+    {
+        std::vector<MInst> insts;
+        for(auto inst : blk.insts)
+        {
+            int spill = -1;
+            if(inst.rd >= VREG && res[inst.rd] == -1 && remat(inst.rd))
+                continue;
+            if(inst.rs1 >= VREG)
+            {
+                int v = inst.rs1;
+                inst.rs1 = res[v] != -1 ? res[v] : T0;
+                if(res[v] == -1)
+                    reload(insts, v, T0);
+                if(inst.rs2 == v)
+                    inst.rs2 = inst.rs1;
+            }
+            if(inst.rs2 >= VREG)
+            {
+                int v = inst.rs2;
+                inst.rs2 = res[v] != -1 ? res[v] : T1;
+                if(res[v] == -1)
+                    reload(insts, v, T1);
+            }
+            if(inst.rd >= VREG)
+            {
+                spill = res[inst.rd] == -1 ? slot(inst.rd) : -1;
+                inst.rd = res[inst.rd] != -1 ? res[inst.rd] : T0;
+            }
+            // 两端都溢出的 mv 变成 t0 到 t0, 只留下写回
+            if(inst.op != RV_MV || inst.rd != inst.rs1)
+                insts.push_back(inst);
+            if(spill != -1)
+                insts.emplace_back(RV_SW, -1, SP, T0).slot = spill;
+        }
+        blk.insts.swap(insts);
+    }
+
+    return;
+}
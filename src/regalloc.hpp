@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+#include "mir.hpp"
+
+// 线性扫描寄存器分配: 为每个虚拟寄存器选择一个物理寄存器, 寄存器不足时按溢出代价选择溢出到栈上的值
+// color 按活跃区间给虚拟寄存器着色, 用于让生存期不重叠的栈槽共用同一块内存
+// coalesce 在分配之前合并通过 mv 相连并且活跃范围不相交的虚拟寄存器
+class LinearScan
+{
+public:
+    // 编号小于 precolored 的是物理寄存器, 它们的活跃范围是其余寄存器的活跃范围不能占用的固定区间
+    // hint 记下通过 mv 相连的寄存器, 分配时优先选择与它们相同的物理寄存器
+    struct Inst
+    {
+        std::vector<int> uses, defs;
+    };
+
+    struct Block
+    {
+        std::vector<Inst> insts;
+        std::vector<int> succ;
+        int depth;
+    };
+
+private:
+    struct Interval
+    {
+        int vreg, start, end;
+        double weight;
+
+        double cost(void) const
+        {
+            return weight / (end - start + 1);
+        }
+    };
+
+    int precolored;
+    std::vector<int> caller, callee;
+    std::vector<std::vector<std::pair<int, int>>> ranges;
+    std::vector<Interval> intervals;
+    std::vector<std::vector<int>> hints;
+
+    void reserve(int reg, int from, int to);
+    bool conflict(int reg, const Interval &it);
+    void build(const std::vector<Block> &blocks, int vregs);
+    std::vector<Interval> sorted(void);
+
+public:
+    LinearScan(int _precolored, const std::vector<int> &_caller = {}, const std::vector<int> &_callee = {});
+
+    void hint(int vreg, int reg);
+    std::vector<int> coalesce(const std::vector<Block> &blocks, int vregs, const std::vector<std::pair<int, int>> &moves);
+    std::vector<int> allocate(const std::vector<Block> &blocks, int vregs);
+    std::vector<int> color(const std::vector<Block> &blocks, int vregs);
+};
+
+void allocate_registers(MFunc &func);
@@ -1,8 +1,27 @@
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "arith.hpp"
+#include "frame.hpp"
 #include "koopa.h"
+#include "koopa_util.hpp"
+#include "layout.hpp"
+#include "mir.hpp"
+#include "output.hpp"
+#include "peephole.hpp"
+#include "regalloc.hpp"
 #include "riscv.hpp"
+#include "schedule.hpp"
+
+static thread_local std::unordered_map<koopa_raw_type_t, int> sizes;
 
 static int type_size(koopa_raw_type_t ty)
 {
@@ -14,7 +33,12 @@ static int type_size(koopa_raw_type_t ty)
     case KOOPA_RTT_UNIT:
         return 0;
     case KOOPA_RTT_ARRAY:
-        return type_size(ty->data.array.base) * ty->data.array.len;
+    {
+        auto it = sizes.find(ty);
+        if(it != sizes.end())
+            return it->second;
+        return sizes[ty] = type_size(ty->data.array.base) * ty->data.array.len;
+    }
     default:
         throw std::runtime_error("error: unknown ty.tag " + std::to_string(ty->tag));
     }
@@ -22,507 +46,653 @@ static int type_size(koopa_raw_type_t ty)
     return 0;
 }
 
-static int inst_size(koopa_raw_value_t kval)
+// 内存地址 offset(base), slot 不为 -1 时再加上栈上对象 slot 的位置
+struct Address
 {
-    return type_size(kval->kind.tag == KOOPA_RVT_ALLOC ? kval->ty->data.pointer.base : kval->ty);
-}
+    int base, offset, slot;
+};
 
-static int blk_size(koopa_raw_basic_block_t kblk, bool &call)
+// 局部变量是标量, 并且只被直接读写, 没有取地址
+static bool promotable(koopa_raw_value_t kalloc)
 {
-    int sz = 0;
-
-    for(int i = 0; i < (int)kblk->insts.len; i ++)
+    if(kalloc->ty->data.pointer.base->tag == KOOPA_RTT_ARRAY)
+        return false;
+    for(int i = 0; i < (int)kalloc->used_by.len; i ++)
     {
-        sz += inst_size((koopa_raw_value_t)kblk->insts.buffer[i]);
-        if(((koopa_raw_value_t)kblk->insts.buffer[i])->kind.tag == KOOPA_RVT_CALL)
-            call = true;
+        auto user = (koopa_raw_value_t)kalloc->used_by.buffer[i];
+        if(user->kind.tag == KOOPA_RVT_LOAD && user->kind.data.load.src == kalloc)
+            continue;
+        if(user->kind.tag == KOOPA_RVT_STORE && user->kind.data.store.dest == kalloc && user->kind.data.store.value != kalloc)
+            continue;
+        return false;
     }
 
-    return sz;
-}
-
-static int func_size(koopa_raw_function_t kfunc, bool &call)
-{
-    int sz = 0;
-
-    for(int i = 0; i < (int)kfunc->bbs.len; i ++)
-        sz += blk_size((koopa_raw_basic_block_t)kfunc->bbs.buffer[i], call);
-    sz += 4 * call;
-
-    return sz;
+    return true;
 }
 
-class Stack
+// 指令选择时当前函数的状态: Koopa 的值对应的虚拟寄存器, 局部变量对应的栈上对象, 基本块编号
+// 只用于访存的数组元素指针不放进寄存器, 在 addrs 中记下它的地址
+class Selector
 {
 private:
-    int reserve, cur;
-    std::map<koopa_raw_value_t, int> addr;
-    bool call;
+    std::unordered_map<koopa_raw_value_t, int> regs, objects, vars;
 
 public:
-    void clear(int sz, bool _call)
-    {
-        reserve = cur = sz;
-        call = _call;
-        addr.clear();
-        cur -= 4 * call;
+    MFunc &func;
+    std::unordered_map<koopa_raw_basic_block_t, int> labels;
+    std::unordered_map<koopa_raw_value_t, Address> addrs;
+    int cur;
 
+    Selector(MFunc &_func) : func(_func), cur(0)
+    {
         return;
     }
 
-    int size(void)
+    int reg(koopa_raw_value_t kval)
     {
-        return reserve;
+        auto it = regs.find(kval);
+        if(it != regs.end())
+            return it->second;
+
+        return regs[kval] = func.vreg();
     }
 
-    int fetch(koopa_raw_value_t kval)
+    int object(koopa_raw_value_t kalloc)
     {
-        if(addr.count(kval))
-            return addr[kval];
+        auto it = objects.find(kalloc);
+        if(it != objects.end())
+            return it->second;
 
-        int t = inst_size(kval);
-        if(!t)
-            return 0;
-        addr[kval] = (cur -= t);
-
-        return cur;
+        return objects[kalloc] = func.object(type_size(kalloc->ty->data.pointer.base));
     }
 
-    bool has_call(void)
+    // 可以放进寄存器的局部变量对应的虚拟寄存器, 其余的返回 -1
+    int var(koopa_raw_value_t kalloc)
     {
-        return call;
+        auto it = vars.find(kalloc);
+        if(it != vars.end())
+            return it->second;
+
+        return vars[kalloc] = promotable(kalloc) ? func.vreg() : -1;
     }
-} stack;
-static std::string current_ident;
 
-static void load_reg(koopa_raw_value_t kval, std::string reg, std::string &res)
-{
-    if(kval->kind.tag == KOOPA_RVT_INTEGER)
-        res += "\tli " + reg + ", " + std::to_string(kval->kind.data.integer.value) + "\n";
-    else if(kval->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
+    std::vector<MInst> &insts(void)
     {
-        res += "\tla t0, " + std::string(kval->name + 1) + "\n";
-        res += "\tlw " + reg + ", 0(t0)\n";
+        return func.blocks[cur].insts;
     }
-    else
+
+    MInst &emit(const MInst &inst)
     {
-        int addr = stack.fetch(kval);
-        if(addr < -2048 || addr > 2047)
-        {
-            res += "\tli t6, " + std::to_string(addr) + "\n";
-            res += "\tadd t6, t6, sp\n";
-            res += "\tlw " + reg + ", 0(t6)\n";
-        }
-        else
-            res += "\tlw " + reg + ", " + std::to_string(addr) + "(sp)\n";
+        insts().push_back(inst);
+
+        return insts().back();
     }
+};
 
-    return;
+// 取得 kval 的值所在的寄存器, 常量先装入一个新的虚拟寄存器, undef 当作 0
+static int load_reg(koopa_raw_value_t kval, Selector &sel)
+{
+    if(kval->kind.tag == KOOPA_RVT_UNDEF)
+        return ZERO;
+    if(kval->kind.tag != KOOPA_RVT_INTEGER)
+        return sel.reg(kval);
+    if(!kval->kind.data.integer.value)
+        return ZERO;
+
+    int reg = sel.func.vreg();
+    sel.emit(MInst(RV_LI, reg, -1, -1, kval->kind.data.integer.value));
+
+    return reg;
 }
 
-static void store_stack(int addr, std::string reg, std::string &res)
+// 取得指针 kval 指向的地址: 全局变量用 la, 局部变量用栈上对象, 数组元素的指针用记下的地址, 其余的指针就是它的值
+static Address load_addr(koopa_raw_value_t kval, Selector &sel)
 {
-    if(addr < -2048 || addr > 2047)
+    if(kval->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
     {
-        res += "\tli t6, " + std::to_string(addr) + "\n";
-        res += "\tadd t6, t6, sp\n";
-        res += "\tsw " + reg + ", 0(t6)\n";
+        int reg = sel.func.vreg();
+        sel.emit(MInst(RV_LA, reg)).sym = kval->name + 1;
+        return {reg, 0, -1};
     }
-    else
-        res += "\tsw " + reg + ", " + std::to_string(addr) + "(sp)\n";
+    if(kval->kind.tag == KOOPA_RVT_ALLOC)
+        return {SP, 0, sel.object(kval)};
 
-    return;
+    auto it = sel.addrs.find(kval);
+    if(it != sel.addrs.end())
+        return it->second;
+
+    return {load_reg(kval, sel), 0, -1};
 }
 
-static void value_aggregate(koopa_raw_value_t kval, std::string &res)
+static void value_aggregate(koopa_raw_value_t kval, Output &res)
 {
     if(kval->ty->tag == KOOPA_RTT_ARRAY)
         for(int i = 0; i < (int)kval->kind.data.aggregate.elems.len; i ++)
             value_aggregate((koopa_raw_value_t)kval->kind.data.aggregate.elems.buffer[i], res);
     else
-        res += "\t.word " + std::to_string(kval->kind.data.integer.value) + "\n";
+        res << "\t.word " << kval->kind.data.integer.value << "\n";
 
     return;
 }
 
-static void value_global_alloc(koopa_raw_value_t kalloc, std::string &res)
+// 放进 .sdata 的全局变量的最大字节数
+static const int SDATA_SIZE = 8;
+
+static void value_global_alloc(koopa_raw_value_t kalloc, Output &res)
 {
-    res += ".globl " + std::string(kalloc->name + 1) + "\n";
-    res += std::string(kalloc->name + 1) + ":\n";
+    res << ".globl " << kalloc->name + 1 << "\n";
+    res << kalloc->name + 1 << ":\n";
     if(kalloc->kind.data.global_alloc.init->kind.tag == KOOPA_RVT_ZERO_INIT)
-        res += "\t.zero " + std::to_string(type_size(kalloc->ty->data.pointer.base)) + "\n";
+        res << "\t.zero " << type_size(kalloc->ty->data.pointer.base) << "\n";
     else if(kalloc->kind.data.global_alloc.init->kind.tag == KOOPA_RVT_AGGREGATE)
         value_aggregate(kalloc->kind.data.global_alloc.init, res);
     else
-        res += "\t.word " + std::to_string(kalloc->kind.data.global_alloc.init->kind.data.integer.value) + "\n";
+        res << "\t.word " << kalloc->kind.data.global_alloc.init->kind.data.integer.value << "\n";
 
     return;
 }
 
-static void value_load(const koopa_raw_load_t *kload, int addr, std::string &res)
+static bool in_range(long long imm)
 {
-    res += "\n";
-    load_reg(kload->src, "t0", res);
-    if(kload->src->kind.tag == KOOPA_RVT_GET_ELEM_PTR || kload->src->kind.tag == KOOPA_RVT_GET_PTR)
-        res += "\tlw t0, 0(t0)\n";
-    store_stack(addr, "t0", res);
-
-    return;
+    return imm >= -2048 && imm <= 2047;
 }
 
-static void value_store(const koopa_raw_store_t *kstore, std::string &res)
+// 交换两个操作数后的运算, 不能交换的返回 -1
+static int swapped_op(koopa_raw_binary_op_t op)
 {
-    std::string dest;
-
-    res += "\n";
-    if(kstore->dest->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
+    switch(op)
     {
-        res += "\tla t1, " + std::string(kstore->dest->name + 1) + "\n";
-        dest = "0(t1)";
+    case KOOPA_RBO_SUB:
+    case KOOPA_RBO_DIV:
+    case KOOPA_RBO_MOD:
+    case KOOPA_RBO_SHL:
+    case KOOPA_RBO_SHR:
+    case KOOPA_RBO_SAR:
+        return -1;
+    case KOOPA_RBO_GT:
+        return KOOPA_RBO_LT;
+    case KOOPA_RBO_LT:
+        return KOOPA_RBO_GT;
+    case KOOPA_RBO_GE:
+        return KOOPA_RBO_LE;
+    case KOOPA_RBO_LE:
+        return KOOPA_RBO_GE;
+    default:
+        return op;
     }
-    else if(kstore->dest->kind.tag == KOOPA_RVT_GET_ELEM_PTR || kstore->dest->kind.tag == KOOPA_RVT_GET_PTR)
+}
+
+static void value_load(const koopa_raw_load_t *kload, int dst, Selector &sel)
+{
+    if(kload->src->kind.tag == KOOPA_RVT_ALLOC && sel.var(kload->src) != -1)
     {
-        load_reg(kstore->dest, "t1", res);
-        dest = "0(t1)";
+        sel.emit(MInst(RV_MV, dst, sel.var(kload->src)));
+        return;
     }
-    else
+
+    auto addr = load_addr(kload->src, sel);
+
+    sel.emit(MInst(RV_LW, dst, addr.base, -1, addr.offset)).slot = addr.slot;
+
+    return;
+}
+
+static void value_store(const koopa_raw_store_t *kstore, Selector &sel)
+{
+    int src = load_reg(kstore->value, sel);
+    if(kstore->dest->kind.tag == KOOPA_RVT_ALLOC && sel.var(kstore->dest) != -1)
     {
-        int addr = stack.fetch(kstore->dest);
-        if(addr < -2048 || addr > 2047)
-        {
-            res += "\tli t1, " + std::to_string(addr) + "\n";
-            res += "\tadd t1, t1, sp\n";
-            dest = "0(t1)";
-        }
-        else
-            dest = std::to_string(addr) + "(sp)";
+        sel.emit(MInst(RV_MV, sel.var(kstore->dest), src));
+        return;
     }
 
-    if(kstore->value->kind.tag == KOOPA_RVT_FUNC_ARG_REF)
+    auto addr = load_addr(kstore->dest, sel);
+
+    sel.emit(MInst(RV_SW, -1, addr.base, src, addr.offset)).slot = addr.slot;
+
+    return;
+}
+
+// 常数下标直接加到偏移量上, 最后成为 lw/sw 的位移; 变量下标乘以元素大小后逐层加到基址上
+// 合并成 ((i * M + j) * K + k) * size 的指令数相同, 而逐层相加时外层的 base + i * size 在内层循环中不变
+static Address value_offset(Address addr, koopa_raw_value_t kindex, int size, Selector &sel)
+{
+    if(kindex->kind.tag == KOOPA_RVT_INTEGER)
     {
-        if(kstore->value->kind.data.func_arg_ref.index < 8)
-            res += "\tsw a" + std::to_string(kstore->value->kind.data.func_arg_ref.index) + ", " + dest + "\n";
-        else
-        {
-            int offset = (kstore->value->kind.data.func_arg_ref.index - 8) * 4;
-            if(offset < -2048 || offset > 2047)
-            {
-                res += "\tli t2, " + std::to_string(offset) + "\n";
-                res += "\taddi t2, t2, sp\n";
-                res += "\tlw t0, 0(t2)\n";
-            }
-            else
-                res += "\tlw t0, " + std::to_string(offset) + "(sp)\n";
-            res += "\tsw t0, " + dest + "\n";
-        }
+        addr.offset += kindex->kind.data.integer.value * size;
+        return addr;
     }
-    else
+
+    int index = load_reg(kindex, sel), offset = sel.func.vreg(), base = sel.func.vreg();
+    if(!mul_const(sel.func, sel.insts(), index, size, offset))
     {
-        load_reg(kstore->value, "t0", res);
-        res += "\tsw t0, " + dest + "\n";
+        int scale = sel.func.vreg();
+        sel.emit(MInst(RV_LI, scale, -1, -1, size));
+        sel.emit(MInst(RV_MUL, offset, index, scale));
     }
+    sel.emit(MInst(RV_ADD, base, addr.base, offset));
+    addr.base = base;
 
-    return;
+    return addr;
+}
+
+static Address value_get_ptr(const koopa_raw_get_ptr_t *kget, Selector &sel)
+{
+    return value_offset(load_addr(kget->src, sel), kget->index, type_size(kget->src->ty->data.pointer.base), sel);
 }
 
-static void value_get_ptr(const koopa_raw_get_ptr_t *kget, int addr, std::string &res)
+static Address value_get_elem_ptr(const koopa_raw_get_elem_ptr_t *kget, Selector &sel)
 {
-    res += "\n";
+    return value_offset(load_addr(kget->src, sel), kget->index, type_size(kget->src->ty->data.pointer.base->data.array.base), sel);
+}
 
-    int src_addr = stack.fetch(kget->src);
-    if(src_addr < -2048 || src_addr > 2047)
+// 指针只作为 load/store 的地址或者 getptr/getelemptr 的基址时, 不需要放进寄存器
+static void value_pointer(koopa_raw_value_t kval, Address addr, Selector &sel)
+{
+    for(int i = 0; i < (int)kval->used_by.len; i ++)
     {
-        res += "\tli t0, " + std::to_string(src_addr) + "\n";
-        res += "\tadd t0, sp, t0\n";
+        auto user = (koopa_raw_value_t)kval->used_by.buffer[i];
+        auto &data = user->kind.data;
+        if((user->kind.tag == KOOPA_RVT_LOAD && data.load.src == kval)
+            || (user->kind.tag == KOOPA_RVT_STORE && data.store.dest == kval && data.store.value != kval)
+            || (user->kind.tag == KOOPA_RVT_GET_PTR && data.get_ptr.src == kval)
+            || (user->kind.tag == KOOPA_RVT_GET_ELEM_PTR && data.get_elem_ptr.src == kval))
+            continue;
+
+        int reg = sel.reg(kval);
+        sel.emit(MInst(RV_ADDI, reg, addr.base, -1, addr.offset)).slot = addr.slot;
+        addr = {reg, 0, -1};
+        break;
     }
-    else
-        res += "\taddi t0, sp, " + std::to_string(src_addr) + "\n";
-    res += "\tlw t0, 0(t0)\n";
-
-    load_reg(kget->index, "t1", res);
-    res += "\tli t2, " + std::to_string(type_size(kget->src->ty->data.pointer.base)) + "\n";
-    res += "\tmul t1, t1, t2\n";
-    res += "\tadd t0, t0, t1\n";
-    store_stack(addr, "t0", res);
+    sel.addrs[kval] = addr;
 
     return;
 }
 
-static void value_get_elem_ptr(const koopa_raw_get_elem_ptr_t *kget, int addr, std::string &res)
+// 右操作数为常数 c 时的模式: 12 位立即数的指令形式, 乘除法的强度削弱
+static bool value_binary_const(koopa_raw_binary_op_t op, int lhs, int c, int dst, Selector &sel)
 {
-    res += "\n";
-
-    if(kget->src->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
-        res += "\tla t0, " + std::string(kget->src->name + 1) + "\n";
-    else
+    switch(op)
+    {
+    case KOOPA_RBO_NOT_EQ:
+    case KOOPA_RBO_EQ:
     {
-        int src_addr = stack.fetch(kget->src);
-        if(src_addr < -2048 || src_addr > 2047)
+        RVOp test = op == KOOPA_RBO_EQ ? RV_SEQZ : RV_SNEZ;
+        if(!c)
         {
-            res += "\tli t0, " + std::to_string(src_addr) + "\n";
-            res += "\tadd t0, sp, t0\n";
+            sel.emit(MInst(test, dst, lhs));
+            return true;
         }
-        else
-            res += "\taddi t0, sp, " + std::to_string(src_addr) + "\n";
-        if(kget->src->kind.tag == KOOPA_RVT_GET_ELEM_PTR || kget->src->kind.tag == KOOPA_RVT_GET_PTR)
-            res += "\tlw t0, 0(t0)\n";
+        if(!in_range(c))
+            return false;
+        int diff = sel.func.vreg();
+        sel.emit(MInst(RV_XORI, diff, lhs, -1, c));
+        sel.emit(MInst(test, dst, diff));
+        return true;
+    }
+    case KOOPA_RBO_LT:
+        if(!in_range(c))
+            return false;
+        sel.emit(MInst(RV_SLTI, dst, lhs, -1, c));
+        return true;
+    case KOOPA_RBO_GE:
+    {
+        if(!in_range(c))
+            return false;
+        int less = sel.func.vreg();
+        sel.emit(MInst(RV_SLTI, less, lhs, -1, c));
+        sel.emit(MInst(RV_XORI, dst, less, -1, 1));
+        return true;
+    }
+    case KOOPA_RBO_LE:
+        if(!in_range(c + 1LL))
+            return false;
+        sel.emit(MInst(RV_SLTI, dst, lhs, -1, c + 1));
+        return true;
+    case KOOPA_RBO_GT:
+    {
+        if(!in_range(c + 1LL))
+            return false;
+        int less = sel.func.vreg();
+        sel.emit(MInst(RV_SLTI, less, lhs, -1, c + 1));
+        sel.emit(MInst(RV_XORI, dst, less, -1, 1));
+        return true;
+    }
+    case KOOPA_RBO_ADD:
+        if(!in_range(c))
+            return false;
+        sel.emit(MInst(RV_ADDI, dst, lhs, -1, c));
+        return true;
+    case KOOPA_RBO_SUB:
+        if(!in_range(-(long long)c))
+            return false;
+        sel.emit(MInst(RV_ADDI, dst, lhs, -1, -c));
+        return true;
+    case KOOPA_RBO_AND:
+    case KOOPA_RBO_OR:
+    case KOOPA_RBO_XOR:
+        if(!in_range(c))
+            return false;
+        sel.emit(MInst(op == KOOPA_RBO_AND ? RV_ANDI : op == KOOPA_RBO_OR ? RV_ORI : RV_XORI, dst, lhs, -1, c));
+        return true;
+    case KOOPA_RBO_SHL:
+        sel.emit(MInst(RV_SLLI, dst, lhs, -1, c & 31));
+        return true;
+    case KOOPA_RBO_SHR:
+        sel.emit(MInst(RV_SRLI, dst, lhs, -1, c & 31));
+        return true;
+    case KOOPA_RBO_SAR:
+        sel.emit(MInst(RV_SRAI, dst, lhs, -1, c & 31));
+        return true;
+    case KOOPA_RBO_MUL:
+        return mul_const(sel.func, sel.insts(), lhs, c, dst);
+    case KOOPA_RBO_DIV:
+    case KOOPA_RBO_MOD:
+        return div_const(sel.func, sel.insts(), op == KOOPA_RBO_MOD, lhs, c, dst);
+    default:
+        return false;
     }
-
-    load_reg(kget->index, "t1", res);
-    res += "\tli t2, " + std::to_string(type_size(kget->src->ty->data.pointer.base->data.array.base)) + "\n";
-    res += "\tmul t1, t1, t2\n";
-    res += "\tadd t0, t0, t1\n";
-    store_stack(addr, "t0", res);
-
-    return;
 }
 
-static void value_binary(const koopa_raw_binary_t *kbinary, int addr, std::string &res)
+static void value_binary(const koopa_raw_binary_t *kbinary, int dst, Selector &sel)
 {
-    res += "\n";
-    load_reg(kbinary->lhs, "t0", res);
-    load_reg(kbinary->rhs, "t1", res);
+    auto op = kbinary->op;
+    auto klhs = kbinary->lhs, krhs = kbinary->rhs;
 
-    switch(kbinary->op)
+    // 常量放到右边, 再尝试立即数和强度削弱的模式, 都不适用时右操作数也装入寄存器
+    if(klhs->kind.tag == KOOPA_RVT_INTEGER && krhs->kind.tag != KOOPA_RVT_INTEGER && swapped_op(op) != -1)
+    {
+        std::swap(klhs, krhs);
+        op = (koopa_raw_binary_op_t)swapped_op(op);
+    }
+
+    int lhs = load_reg(klhs, sel);
+    if(krhs->kind.tag == KOOPA_RVT_INTEGER && value_binary_const(op, lhs, krhs->kind.data.integer.value, dst, sel))
+        return;
+    int rhs = load_reg(krhs, sel);
+
+    switch(op)
     {
     case KOOPA_RBO_NOT_EQ:
-        res += "\txor t0, t0, t1\n";
-        res += "\tsnez t0, t0\n";
+        sel.emit(MInst(RV_XOR, dst, lhs, rhs));
+        sel.emit(MInst(RV_SNEZ, dst, dst));
         break;
     case KOOPA_RBO_EQ:
-        res += "\txor t0, t0, t1\n";
-        res += "\tseqz t0, t0\n";
+        sel.emit(MInst(RV_XOR, dst, lhs, rhs));
+        sel.emit(MInst(RV_SEQZ, dst, dst));
         break;
     case KOOPA_RBO_GT:
-        res += "\tsgt t0, t0, t1\n";
+        sel.emit(MInst(RV_SGT, dst, lhs, rhs));
         break;
     case KOOPA_RBO_LT:
-        res += "\tslt t0, t0, t1\n";
+        sel.emit(MInst(RV_SLT, dst, lhs, rhs));
         break;
     case KOOPA_RBO_GE:
-        res += "\tslt t0, t0, t1\n";
-        res += "\txori t0, t0, 1\n";
+        sel.emit(MInst(RV_SLT, dst, lhs, rhs));
+        sel.emit(MInst(RV_XORI, dst, dst, -1, 1));
         break;
     case KOOPA_RBO_LE:
-        res += "\tsgt t0, t0, t1\n";
-        res += "\txori t0, t0, 1\n";
+        sel.emit(MInst(RV_SGT, dst, lhs, rhs));
+        sel.emit(MInst(RV_XORI, dst, dst, -1, 1));
         break;
     case KOOPA_RBO_ADD:
-        res += "\tadd t0, t0, t1\n";
+        sel.emit(MInst(RV_ADD, dst, lhs, rhs));
         break;
     case KOOPA_RBO_SUB:
-        res += "\tsub t0, t0, t1\n";
+        sel.emit(MInst(RV_SUB, dst, lhs, rhs));
         break;
     case KOOPA_RBO_MUL:
-        res += "\tmul t0, t0, t1\n";
+        sel.emit(MInst(RV_MUL, dst, lhs, rhs));
         break;
     case KOOPA_RBO_DIV:
-        res += "\tdiv t0, t0, t1\n";
+        sel.emit(MInst(RV_DIV, dst, lhs, rhs));
         break;
     case KOOPA_RBO_MOD:
-        res += "\trem t0, t0, t1\n";
+        sel.emit(MInst(RV_REM, dst, lhs, rhs));
         break;
     case KOOPA_RBO_AND:
-        res += "\tand t0, t0, t1\n";
+        sel.emit(MInst(RV_AND, dst, lhs, rhs));
         break;
     case KOOPA_RBO_OR:
-        res += "\tor t0, t0, t1\n";
+        sel.emit(MInst(RV_OR, dst, lhs, rhs));
         break;
     case KOOPA_RBO_XOR:
-        res += "\txor t0, t0, t1\n";
+        sel.emit(MInst(RV_XOR, dst, lhs, rhs));
         break;
     case KOOPA_RBO_SHL:
-        res += "\tsll t0, t0, t1\n";
+        sel.emit(MInst(RV_SLL, dst, lhs, rhs));
         break;
     case KOOPA_RBO_SHR:
-        res += "\tsrl t0, t0, t1\n";
+        sel.emit(MInst(RV_SRL, dst, lhs, rhs));
         break;
     case KOOPA_RBO_SAR:
-        res += "\tsra t0, t0, t1\n";
+        sel.emit(MInst(RV_SRA, dst, lhs, rhs));
         break;
     }
-    store_stack(addr, "t0", res);
 
     return;
 }
 
-static void value_branch(const koopa_raw_branch_t *kbranch, std::string &res)
+static bool in_args(koopa_raw_value_t kval, const koopa_raw_slice_t &args)
 {
-    static int magic;
-
-    res += "\n";
-    load_reg(kbranch->cond, "t0", res);
-    res += "\tbnez t0, " + current_ident + "_skip" + std::to_string(magic) + "\n";
-    res += "\tj " + current_ident + "_" + std::string(kbranch->false_bb->name + 1) + "\n";
-    res += current_ident + "_skip" + std::to_string(magic ++) + ":\n";
-    res += "\tj " + current_ident + "_" + std::string(kbranch->true_bb->name + 1) + "\n";
+    for(int i = 0; i < (int)args.len; i ++)
+        if(args.buffer[i] == kval)
+            return true;
 
-    return;
+    return false;
 }
 
-static void value_jump(const koopa_raw_jump_t *kjump, std::string &res)
+// 只作为一条 br 的条件使用的比较不单独计算, 由 br 直接生成对应的条件跳转
+// 同时作为 br 的块参数传递时仍要算出结果
+static bool fused_compare(koopa_raw_value_t kval)
 {
-    res += "\n";
-    res += "\tj " + current_ident + "_" + std::string(kjump->target->name + 1) + "\n";
-
-    return;
+    if(kval->kind.tag != KOOPA_RVT_BINARY || kval->used_by.len != 1)
+        return false;
+    koopa_raw_value_t kuser = (koopa_raw_value_t)kval->used_by.buffer[0];
+    if(kuser->kind.tag != KOOPA_RVT_BRANCH || kuser->kind.data.branch.cond != kval)
+        return false;
+    if(in_args(kval, kuser->kind.data.branch.true_args) || in_args(kval, kuser->kind.data.branch.false_args))
+        return false;
+
+    switch(kval->kind.data.binary.op)
+    {
+    case KOOPA_RBO_NOT_EQ:
+    case KOOPA_RBO_EQ:
+    case KOOPA_RBO_GT:
+    case KOOPA_RBO_LT:
+    case KOOPA_RBO_GE:
+    case KOOPA_RBO_LE:
+        return true;
+    default:
+        return false;
+    }
 }
 
-static void value_call(const koopa_raw_call_t *kcall, int addr, std::string &res)
+static MInst &value_compare_branch(const koopa_raw_binary_t *kbinary, Selector &sel)
 {
-    res += "\n";
-    for(int i = 0; i < std::min((int)kcall->args.len, 8); i ++)
-        load_reg((koopa_raw_value_t)kcall->args.buffer[i], "a" + std::string(1, '0' + i), res);
+    int lhs = load_reg(kbinary->lhs, sel);
+    int rhs = load_reg(kbinary->rhs, sel);
 
-    bool call = false;
-    int sz = func_size(kcall->callee, call);
-    if(sz)
-        sz = ((sz - 1) / 16 + 1) * 16;
-    for(int i = 8; i < (int)kcall->args.len; i ++)
+    switch(kbinary->op)
     {
-        load_reg((koopa_raw_value_t)kcall->args.buffer[i], "t0", res);
-        int offset = (i - 8) * 4 - sz;
-        if(offset < -2048 || offset > 2047)
-        {
-            res += "\tli t6, " + std::to_string(offset) + "\n";
-            res += "\tadd t6, t6, sp\n";
-            res += "\tsw t0, 0(t6)\n";
-        }
-        else
-            res += "\tsw t0, " + std::to_string(offset) + "(sp)\n";
+    case KOOPA_RBO_NOT_EQ:
+        return rhs == ZERO ? sel.emit(MInst(RV_BNEZ, -1, lhs)) : sel.emit(MInst(RV_BNE, -1, lhs, rhs));
+    case KOOPA_RBO_EQ:
+        return rhs == ZERO ? sel.emit(MInst(RV_BEQZ, -1, lhs)) : sel.emit(MInst(RV_BEQ, -1, lhs, rhs));
+    case KOOPA_RBO_GT:
+        return sel.emit(MInst(RV_BLT, -1, rhs, lhs));
+    case KOOPA_RBO_LT:
+        return sel.emit(MInst(RV_BLT, -1, lhs, rhs));
+    case KOOPA_RBO_GE:
+        return sel.emit(MInst(RV_BGE, -1, lhs, rhs));
+    default:
+        return sel.emit(MInst(RV_BGE, -1, rhs, lhs));
     }
-    res += "\tcall " + std::string(kcall->callee->name + 1) + "\n";
-    if(addr != -1)
-        store_stack(addr, "a0", res);
-
-    return;
 }
 
-static void value_return(const koopa_raw_return_t *kret, std::string &res)
+// 把实参并行复制到目标块的参数: 先复制目标不再被其他复制读取的, 剩下的是环, 用一个临时寄存器断开
+static void block_args(koopa_raw_basic_block_t kblk, const koopa_raw_slice_t &args, Selector &sel)
 {
-    res += "\n";
-    if(kret->value)
-        load_reg(kret->value, "a0", res);
-    if(stack.has_call())
+    std::vector<std::pair<int, int>> copies;
+    for(int i = 0; i < (int)args.len; i ++)
     {
-        int offset = stack.size() - 4;
-        if(offset < -2048 || offset > 2047)
-        {
-            res += "\tli t6, " + std::to_string(offset) + "\n";
-            res += "\tadd t6, t6, sp\n";
-            res += "\tlw ra, 0(t6)\n";
-        }
-        else
-            res += "\tlw ra, " + std::to_string(offset) + "(sp)\n";
+        int dst = sel.reg((koopa_raw_value_t)kblk->params.buffer[i]);
+        int src = load_reg((koopa_raw_value_t)args.buffer[i], sel);
+        if(dst != src)
+            copies.push_back({dst, src});
     }
-    if(stack.size())
+
+    while(!copies.empty())
     {
-        int sz = stack.size();
-        if(sz < -2048 || sz > 2047)
+        bool progress = false;
+        for(int i = 0; i < (int)copies.size(); )
+        {
+            int dst = copies[i].first;
+            bool read = false;
+            for(auto &copy : copies)
+                read |= copy.second == dst;
+            if(read)
+            {
+                i ++;
+                continue;
+            }
+            sel.emit(MInst(RV_MV, dst, copies[i].second));
+            copies.erase(copies.begin() + i);
+            progress = true;
+        }
+        if(!progress)
         {
-            res += "\tli t0, " + std::to_string(sz) + "\n";
-            res += "\tadd sp, sp, t0\n";
+            int tmp = sel.func.vreg(), dst = copies[0].first;
+            sel.emit(MInst(RV_MV, tmp, dst));
+            for(auto &copy : copies)
+                if(copy.second == dst)
+                    copy.second = tmp;
         }
-        else
-            res += "\taddi sp, sp, " + std::to_string(sz) + "\n";
     }
-    res += "\tret\n";
 
     return;
 }
 
-///////////////////////////////////////////////////////////////
+// 带参数的边: 条件跳转先跳到一个新块, 在那里复制参数后再跳到目标
+static int edge_block(koopa_raw_basic_block_t kblk, const koopa_raw_slice_t &args, Selector &sel)
+{
+    if(!args.len)
+        return sel.labels[kblk];
+
+    int cur = sel.cur, res = sel.func.blocks.size();
+    sel.func.blocks.push_back({"edge" + std::to_string(res), {}});
+    sel.cur = res;
+    block_args(kblk, args, sel);
+    sel.emit(MInst(RV_J)).target = sel.labels[kblk];
+    sel.cur = cur;
 
-static void visit_slice(const koopa_raw_slice_t *rs, std::string &res);
+    return res;
+}
 
-static void visit_func(koopa_raw_function_t kfunc, std::string &res)
+static void value_branch(const koopa_raw_branch_t *kbranch, Selector &sel)
 {
-    if(!kfunc->bbs.len)
-        return;
+    int true_bb = edge_block(kbranch->true_bb, kbranch->true_args, sel);
+    int false_bb = edge_block(kbranch->false_bb, kbranch->false_args, sel);
 
-    res += ".globl " + std::string(kfunc->name + 1) + "\n";
-    res += std::string(kfunc->name + 1) + ":\n";
+    if(fused_compare(kbranch->cond))
+        value_compare_branch(&kbranch->cond->kind.data.binary, sel).target = true_bb;
+    else
+        sel.emit(MInst(RV_BNEZ, -1, load_reg(kbranch->cond, sel))).target = true_bb;
+    sel.emit(MInst(RV_J)).target = false_bb;
 
-    bool call = false;
-    int size = func_size(kfunc, call);
-    if(size)
-    {
-        size = ((size - 1) / 16 + 1) * 16;
-        if(-size < -2048 || -size > 2047)
-        {
-            res += "\tli t0, " + std::to_string(-size) + "\n";
-            res += "\tadd sp, sp, t0\n";
-        }
-        else
-            res += "\taddi sp, sp, " + std::to_string(-size) + "\n";
-    }
-    if(call)
-    {
-        int offset = size - 4;
-        if(offset < -2048 || offset > 2047)
-        {
-            res += "\tli t0, " + std::to_string(offset) + "\n";
-            res += "\tadd t0, sp, t0\n";
-            res += "\tsw ra, 0(t0)\n";
-        }
-        else
-            res += "\tsw ra, " + std::to_string(offset) + "(sp)\n";
-    }
-    stack.clear(size, call);
-    current_ident = std::string(kfunc->name + 1);
-    visit_slice(&kfunc->bbs, res);
+    return;
+}
+
+static void value_jump(const koopa_raw_jump_t *kjump, Selector &sel)
+{
+    block_args(kjump->target, kjump->args, sel);
+    sel.emit(MInst(RV_J)).target = sel.labels[kjump->target];
+
+    return;
+}
+
+static void value_call(const koopa_raw_call_t *kcall, int dst, Selector &sel)
+{
+    int n = kcall->args.len;
+    std::vector<int> args;
+
+    for(int i = 0; i < n; i ++)
+        args.push_back(load_reg((koopa_raw_value_t)kcall->args.buffer[i], sel));
+    for(int i = 8; i < n; i ++)
+        sel.emit(MInst(RV_SW, -1, SP, args[i], (i - 8) * 4));
+    for(int i = 0; i < std::min(n, 8); i ++)
+        sel.emit(MInst(RV_MV, A0 + i, args[i]));
+    sel.emit(MInst(RV_CALL, -1, -1, -1, std::min(n, 8))).sym = kcall->callee->name + 1;
+    if(dst != -1)
+        sel.emit(MInst(RV_MV, dst, A0));
+
+    sel.func.has_call = true;
+    sel.func.out_size = std::max(sel.func.out_size, (n - 8) * 4);
 
     return;
 }
 
-static void visit_block(koopa_raw_basic_block_t kblk, std::string &res)
+// 尾调用: 参数放进 a0-a7 后, 恢复栈帧并跳转到被调函数
+static void value_tail_call(const koopa_raw_call_t *kcall, Selector &sel)
 {
-    res += "\n" + current_ident + "_" + std::string(kblk->name + 1) + ":\n";
-    visit_slice(&kblk->insts, res);
+    int n = kcall->args.len;
+    std::vector<int> args;
+
+    for(int i = 0; i < n; i ++)
+        args.push_back(load_reg((koopa_raw_value_t)kcall->args.buffer[i], sel));
+    for(int i = 0; i < n; i ++)
+        sel.emit(MInst(RV_MV, A0 + i, args[i]));
+    sel.emit(MInst(RV_TAIL, -1, -1, -1, n)).sym = kcall->callee->name + 1;
 
     return;
 }
 
-static void visit_value(koopa_raw_value_t kval, std::string &res)
+static void value_return(const koopa_raw_return_t *kret, Selector &sel)
 {
-    int addr = stack.fetch(kval);
+    if(kret->value)
+        sel.emit(MInst(RV_MV, A0, load_reg(kret->value, sel)));
+    sel.emit(MInst(RV_RET, -1, -1, -1, kret->value != nullptr));
+
+    return;
+}
+
+///////////////////////////////////////////////////////////////
 
+static void visit_value(koopa_raw_value_t kval, Selector &sel)
+{
     switch(kval->kind.tag)
     {
-    case KOOPA_RVT_INTEGER:
-        res += std::to_string(kval->kind.data.integer.value);
-        break;
     case KOOPA_RVT_ALLOC:
-        break;
-    case KOOPA_RVT_GLOBAL_ALLOC:
-        value_global_alloc(kval, res);
+        if(sel.var(kval) == -1)
+            sel.object(kval);
         break;
     case KOOPA_RVT_LOAD:
-        value_load(&kval->kind.data.load, addr, res);
+        value_load(&kval->kind.data.load, sel.reg(kval), sel);
         break;
     case KOOPA_RVT_STORE:
-        value_store(&kval->kind.data.store, res);
+        value_store(&kval->kind.data.store, sel);
         break;
     case KOOPA_RVT_GET_PTR:
-        value_get_ptr(&kval->kind.data.get_ptr, addr, res);
+        value_pointer(kval, value_get_ptr(&kval->kind.data.get_ptr, sel), sel);
         break;
     case KOOPA_RVT_GET_ELEM_PTR:
-        value_get_elem_ptr(&kval->kind.data.get_elem_ptr, addr, res);
+        value_pointer(kval, value_get_elem_ptr(&kval->kind.data.get_elem_ptr, sel), sel);
         break;
     case KOOPA_RVT_BINARY:
-        value_binary(&kval->kind.data.binary, addr, res);
+        if(!fused_compare(kval))
+            value_binary(&kval->kind.data.binary, sel.reg(kval), sel);
         break;
     case KOOPA_RVT_BRANCH:
-        value_branch(&kval->kind.data.branch, res);
+        value_branch(&kval->kind.data.branch, sel);
         break;
     case KOOPA_RVT_JUMP:
-        value_jump(&kval->kind.data.jump, res);
+        value_jump(&kval->kind.data.jump, sel);
         break;
     case KOOPA_RVT_CALL:
-        value_call(&kval->kind.data.call, kval->ty->tag == KOOPA_RTT_UNIT ? -1 : addr, res);
+        value_call(&kval->kind.data.call, kval->ty->tag == KOOPA_RTT_UNIT ? -1 : sel.reg(kval), sel);
         break;
     case KOOPA_RVT_RETURN:
-        value_return(&kval->kind.data.ret, res);
+        value_return(&kval->kind.data.ret, sel);
         break;
     default:
         throw std::runtime_error("error: unknown kval.tag " + std::to_string(kval->kind.tag));
@@ -531,33 +701,166 @@ static void visit_value(koopa_raw_value_t kval, std::string &res)
     return;
 }
 
-static void visit_slice(const koopa_raw_slice_t *rs, std::string &res)
+// call 之后直接返回它的结果, 参数都能放在寄存器中, 并且不指向当前栈帧时可以改为尾调用
+static bool tail_call(koopa_raw_value_t kval, koopa_raw_value_t next)
 {
-    for(int i = 0; i < (int)rs->len; i ++)
-        switch(rs->kind)
+    if(kval->kind.tag != KOOPA_RVT_CALL || next->kind.tag != KOOPA_RVT_RETURN)
+        return false;
+    if(next->kind.data.ret.value != (kval->ty->tag == KOOPA_RTT_UNIT ? nullptr : kval))
+        return false;
+
+    auto &args = kval->kind.data.call.args;
+    if(args.len > 8)
+        return false;
+    for(int i = 0; i < (int)args.len; i ++)
+        if(frame_pointer((koopa_raw_value_t)args.buffer[i]))
+            return false;
+
+    return true;
+}
+
+static void visit_block(koopa_raw_basic_block_t kblk, Selector &sel)
+{
+    int n = kblk->insts.len;
+
+    sel.cur = sel.labels[kblk];
+    for(int i = 0; i < n; i ++)
+    {
+        auto kval = (koopa_raw_value_t)kblk->insts.buffer[i];
+        if(i + 1 < n && tail_call(kval, (koopa_raw_value_t)kblk->insts.buffer[i + 1]))
         {
-        case KOOPA_RSIK_FUNCTION:
-            visit_func((koopa_raw_function_t)rs->buffer[i], res);
-            break;
-        case KOOPA_RSIK_BASIC_BLOCK:
-            visit_block((koopa_raw_basic_block_t)rs->buffer[i], res);
-            break;
-        case KOOPA_RSIK_VALUE:
-            visit_value((koopa_raw_value_t)rs->buffer[i], res);
+            value_tail_call(&kval->kind.data.call, sel);
             break;
         }
+        visit_value(kval, sel);
+    }
 
     return;
 }
 
-std::string koopa2riscv(const koopa_raw_program_t *krp)
+// 指令选择: 把 Koopa 函数翻译成使用虚拟寄存器的机器代码
+static void visit_func(koopa_raw_function_t kfunc, MFunc &func)
 {
-    std::string res;
+    Selector sel(func);
 
-    res += ".data\n";
-    visit_slice(&krp->values, res);
-    res += ".text\n";
-    visit_slice(&krp->funcs, res);
+    for(int i = 0; i < (int)kfunc->bbs.len; i ++)
+    {
+        auto kblk = (koopa_raw_basic_block_t)kfunc->bbs.buffer[i];
+        sel.labels[kblk] = i;
+        func.blocks.push_back({kblk->name + 1, {}});
+    }
 
-    return res;
+    // 参数在入口处复制到虚拟寄存器, 前 8 个在 a0-a7 中, 其余的在调用者的栈帧底部
+    for(int i = 0; i < (int)kfunc->params.len; i ++)
+    {
+        int reg = sel.reg((koopa_raw_value_t)kfunc->params.buffer[i]);
+        if(i < 8)
+            sel.emit(MInst(RV_MV, reg, A0 + i));
+        else
+            sel.emit(MInst(RV_LW, reg, SP)).slot = func.object(4, i - 8);
+    }
+
+    for(int i = 0; i < (int)kfunc->bbs.len; i ++)
+        visit_block((koopa_raw_basic_block_t)kfunc->bbs.buffer[i], sel);
+
+    return;
+}
+
+static void gen_func(koopa_raw_function_t kfunc, const Pipeline &pipeline, Peephole &peephole, Output &res)
+{
+    if(!kfunc->bbs.len)
+        return;
+
+    MFunc func(kfunc->name + 1);
+    visit_func(kfunc, func);
+    layout_blocks(func);
+    schedule(func, pipeline);
+    allocate_registers(func);
+    peephole.run(func);
+    schedule(func, pipeline);
+    lower_frame(func);
+    print_func(func, res);
+
+    return;
+}
+
+void koopa2riscv(const koopa_raw_program_t *krp, Output &res, const Pipeline &pipeline, int jobs, std::ostream *stats)
+{
+    Peephole peephole;
+
+    // 小的全局变量放在 .sdata: 汇编没有相对 gp 的寻址写法, 只有链接器松弛时 la 才会变成相对 gp 的一条 addi
+    // 链接时不松弛的话 .sdata 只改变数据的位置, 访问仍然是 la 加上 lw/sw
+    sizes.clear();
+    for(int small = 1; small >= 0; small --)
+    {
+        res << (small ? ".sdata\n" : ".data\n");
+        for(int i = 0; i < (int)krp->values.len; i ++)
+        {
+            auto kalloc = (koopa_raw_value_t)krp->values.buffer[i];
+            if((type_size(kalloc->ty->data.pointer.base) <= SDATA_SIZE) == (bool)small)
+                value_global_alloc(kalloc, res);
+        }
+    }
+    res << ".text\n";
+
+    int n = krp->funcs.len;
+    jobs = std::min(jobs, n);
+    if(jobs <= 1)
+    {
+        for(int i = 0; i < n; i ++)
+            gen_func((koopa_raw_function_t)krp->funcs.buffer[i], pipeline, peephole, res);
+        if(stats)
+            peephole.report(*stats);
+        return;
+    }
+
+    // 每个函数独立生成到各自的缓冲区, 再按源程序顺序拼接
+    std::vector<Output> bufs(n);
+    std::vector<char> finished(n, false);
+    std::exception_ptr error;
+    std::atomic<int> next(0);
+    std::mutex lock;
+    std::condition_variable cond;
+    std::vector<std::thread> workers;
+
+    for(int i = 0; i < jobs; i ++)
+        workers.emplace_back([&]
+        {
+            sizes.clear();
+            for(int k = next ++; k < n; k = next ++)
+            {
+                try
+                {
+                    gen_func((koopa_raw_function_t)krp->funcs.buffer[k], pipeline, peephole, bufs[k]);
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if(!error)
+                        error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> guard(lock);
+                finished[k] = true;
+                cond.notify_all();
+            }
+        });
+
+    for(int k = 0; k < n; k ++)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cond.wait(guard, [&]{ return finished[k]; });
+            if(error)
+                break;
+        }
+        res.splice(bufs[k]);
+    }
+    for(auto &worker : workers)
+        worker.join();
+    if(error)
+        std::rethrow_exception(error);
+    if(stats)
+        peephole.report(*stats);
+
+    return;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <string>
+#include <ostream>
 #include "koopa.h"
+#include "output.hpp"
+#include "schedule.hpp"
 
-std::string koopa2riscv(const koopa_raw_program_t *krp);
+void koopa2riscv(const koopa_raw_program_t *krp, Output &res, const Pipeline &pipeline, int jobs = 1, std::ostream *stats = nullptr);
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "mir.hpp"
+#include "schedule.hpp"
+
+// 常见 RV32 核的近似延迟, 按各自手册中的典型值取整
+static const Pipeline pipelines[] = {
+    {"generic", 1, 3, 3, 20},
+    {"rocket", 1, 3, 4, 33},
+    {"sifive-e31", 1, 2, 3, 34},
+    {"sifive-e76", 1, 3, 3, 20}
+};
+
+// 同时活跃的块内临时值达到这个数目后, 优先选择不增加寄存器压力的指令, 略小于可分配的调用者保存寄存器数
+static const int PRESSURE = 10;
+
+// 很长的基本块按这个长度分段调度, 建依赖图的代价不随块长平方增长
+static const int REGION = 256;
+
+Pipeline find_pipeline(const std::string &spec)
+{
+    for(auto &pipeline : pipelines)
+        if(spec == pipeline.name)
+            return pipeline;
+
+    int load, mul, div;
+    char end;
+    if(std::sscanf(spec.c_str(), "%d,%d,%d%c", &load, &mul, &div, &end) == 3 && load > 0 && mul > 0 && div > 0)
+        return {"custom", 1, load, mul, div};
+
+    throw std::runtime_error("error: unknown pipeline " + spec);
+}
+
+static int latency(const MInst &inst, const Pipeline &pipeline)
+{
+    switch(inst.op)
+    {
+    case RV_LW:
+        return pipeline.load;
+    case RV_MUL:
+    case RV_MULH:
+        return pipeline.mul;
+    case RV_DIV:
+    case RV_REM:
+        return pipeline.div;
+    default:
+        return pipeline.alu;
+    }
+}
+
+// 一次访存: version 是此前基址寄存器在区域内被写过的次数
+struct Access
+{
+    int node, base, version, offset, slot;
+};
+
+// 不同的栈上对象, 或者同一个基址上不重叠的偏移量, 一定是不同的内存
+static bool disjoint(const Access &a, const Access &b)
+{
+    if(a.slot != -1 && b.slot != -1 && a.slot != b.slot)
+        return true;
+
+    return a.base == b.base && a.version == b.version && a.slot == b.slot && (a.offset + 4 <= b.offset || b.offset + 4 <= a.offset);
+}
+
+// 依赖图的结点, 边上是前一条指令发射后, 后一条指令至少要等待的周期数
+struct Node
+{
+    std::vector<std::pair<int, int>> succ;
+    std::vector<int> defs, uses;
+    int preds, height, earliest;
+};
+
+// 按寄存器编号索引的状态, 整个函数共用, 每个区域结束后只清掉用到的项
+// total 是寄存器在整个函数中出现的次数, count 和 remaining 是在区域中出现和尚未调度的使用次数
+struct Registers
+{
+    std::vector<int> total, last_def, version, count, remaining;
+    std::vector<char> live;
+    std::vector<std::vector<int>> readers;
+};
+
+// 列表调度 insts[lo, hi): 优先发射操作数已经就绪, 到区域结束的关键路径最长的指令
+static void schedule_region(std::vector<MInst> &insts, int lo, int hi, const Pipeline &pipeline, Registers &regs)
+{
+    int m = hi - lo;
+    if(m < 2)
+        return;
+
+    std::vector<Node> nodes(m);
+    std::vector<Access> loads, stores;
+    std::vector<int> touched;
+    auto edge = [&](int from, int to, int lat)
+    {
+        nodes[from].succ.push_back({to, lat});
+        nodes[to].preds ++;
+    };
+    auto touch = [&](int r)
+    {
+        if(!regs.count[r] && regs.last_def[r] == -1 && !regs.version[r])
+            touched.push_back(r);
+    };
+
+    for(int j = 0; j < m; j ++)
+    {
+        auto &inst = insts[lo + j];
+        auto &node = nodes[j];
+        node.preds = node.earliest = 0;
+        inst.regs(node.defs, node.uses);
+        node.defs.erase(std::remove(node.defs.begin(), node.defs.end(), (int)ZERO), node.defs.end());
+        node.uses.erase(std::remove(node.uses.begin(), node.uses.end(), (int)ZERO), node.uses.end());
+
+        for(int r : node.uses)
+        {
+            touch(r);
+            if(regs.last_def[r] != -1)
+                edge(regs.last_def[r], j, latency(insts[lo + regs.last_def[r]], pipeline));
+            regs.readers[r].push_back(j);
+            regs.count[r] ++;
+            regs.remaining[r] ++;
+        }
+
+        // 访存之间只保留可能访问同一地址的顺序
+        if(inst.op == RV_LW || inst.op == RV_SW)
+        {
+            Access acc = {j, inst.rs1, regs.version[inst.rs1], inst.imm, inst.slot};
+            for(auto &prev : stores)
+                if(!disjoint(prev, acc))
+                    edge(prev.node, j, inst.op == RV_LW ? pipeline.alu : 0);
+            if(inst.op == RV_SW)
+                for(auto &prev : loads)
+                    if(!disjoint(prev, acc))
+                        edge(prev.node, j, 0);
+            (inst.op == RV_LW ? loads : stores).push_back(acc);
+        }
+
+        for(int r : node.defs)
+        {
+            touch(r);
+            for(int k : regs.readers[r])
+                if(k != j)
+                    edge(k, j, 0);
+            regs.readers[r].clear();
+            if(regs.last_def[r] != -1)
+                edge(regs.last_def[r], j, 0);
+            regs.last_def[r] = j;
+            regs.version[r] ++;
+            regs.count[r] ++;
+        }
+    }
+
+    // 优先级是到区域结束的路径上需要填充的周期数, 只有单周期指令的路径不需要提前
+    for(int j = m - 1; j >= 0; j --)
+    {
+        nodes[j].height = latency(insts[lo + j], pipeline) - 1;
+        for(auto &[s, lat] : nodes[j].succ)
+            nodes[j].height = std::max(nodes[j].height, lat - 1 + nodes[s].height);
+    }
+
+    // 只在这个区域中出现的虚拟寄存器是块内临时值, 最后一次使用之后就不再占用寄存器
+    int live = 0;
+    auto local = [&](int r)
+    {
+        return r >= VREG && regs.count[r] == regs.total[r];
+    };
+    auto pressure = [&](int j)
+    {
+        int delta = 0;
+        for(int r : nodes[j].defs)
+            if(local(r) && regs.remaining[r] && !regs.live[r])
+                delta ++;
+        for(int r : nodes[j].uses)
+            if(local(r) && regs.live[r] && regs.remaining[r] == (int)std::count(nodes[j].uses.begin(), nodes[j].uses.end(), r))
+                delta --;
+        return delta;
+    };
+
+    std::vector<int> avail, order;
+    for(int j = 0; j < m; j ++)
+        if(!nodes[j].preds)
+            avail.push_back(j);
+    for(int cycle = 0; !avail.empty(); )
+    {
+        // 压力过高时不再按延迟选择, 先选不增加压力的指令, 否则回到原来的顺序
+        bool full = live >= PRESSURE;
+        int best = -1;
+        std::tuple<bool, int, int, int> key;
+        for(int j : avail)
+        {
+            auto cur = full ? std::make_tuple(pressure(j) > 0, 0, 0, j) : std::make_tuple(false, std::max(0, nodes[j].earliest - cycle), -nodes[j].height, j);
+            if(best == -1 || cur < key)
+            {
+                best = j;
+                key = cur;
+            }
+        }
+        avail.erase(std::find(avail.begin(), avail.end(), best));
+        order.push_back(best);
+
+        int issue = std::max(cycle, nodes[best].earliest);
+        cycle = issue + 1;
+        for(auto &[s, lat] : nodes[best].succ)
+        {
+            nodes[s].earliest = std::max(nodes[s].earliest, issue + lat);
+            if(!-- nodes[s].preds)
+                avail.push_back(s);
+        }
+        for(int r : nodes[best].uses)
+            if(!-- regs.remaining[r] && regs.live[r])
+            {
+                regs.live[r] = false;
+                live --;
+            }
+        for(int r : nodes[best].defs)
+            if(local(r) && regs.remaining[r] && !regs.live[r])
+            {
+                regs.live[r] = true;
+                live ++;
+            }
+    }
+
+    for(int r : touched)
+    {
+        regs.last_def[r] = -1;
+        regs.version[r] = regs.count[r] = regs.remaining[r] = 0;
+        regs.live[r] = false;
+        regs.readers[r].clear();
+    }
+
+    std::vector<MInst> res;
+    for(int j : order)
+        res.push_back(insts[lo + j]);
+    std::copy(res.begin(), res.end(), insts.begin() + lo);
+
+    return;
+}
+
+// 每个基本块以 call 和跳转为界分成若干区域, 在区域内重排指令
+void schedule(MFunc &func, const Pipeline &pipeline)
+{
+    int n = func.vreg_count();
+    Registers regs = {std::vector<int>(n, 0), std::vector<int>(n, -1), std::vector<int>(n, 0), std::vector<int>(n, 0), std::vector<int>(n, 0), std::vector<char>(n, false), std::vector<std::vector<int>>(n)};
+    std::vector<int> defs, uses;
+
+    for(auto &blk : func.blocks)
+        for(auto &inst : blk.insts)
+        {
+            defs.clear();
+            uses.clear();
+            inst.regs(defs, uses);
+            for(int r : defs)
+                regs.total[r] ++;
+            for(int r : uses)
+                regs.total[r] ++;
+        }
+
+    for(auto &blk : func.blocks)
+    {
+        int lo = 0, size = blk.insts.size();
+        for(int i = 0; i <= size; i ++)
+            if(i == size || blk.insts[i].op == RV_CALL || blk.insts[i].is_terminator())
+            {
+                schedule_region(blk.insts, lo, i, pipeline, regs);
+                if(i < size && blk.insts[i].is_terminator())
+                    break;
+                lo = i + 1;
+            }
+            else if(i - lo == REGION)
+            {
+                schedule_region(blk.insts, lo, i, pipeline, regs);
+                lo = i;
+            }
+    }
+
+    return;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include "mir.hpp"
+
+// 按顺序发射的流水线的延迟模型: 各类指令的结果在发射后第几个周期可以使用
+struct Pipeline
+{
+    const char *name;
+    int alu, load, mul, div;
+};
+
+// 内置的核名, 或者用 "load,mul,div" 直接给出延迟
+Pipeline find_pipeline(const std::string &spec);
+
+void schedule(MFunc &func, const Pipeline &pipeline);
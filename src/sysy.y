@@ -1,37 +1,64 @@
 %code requires
 {
+    #include <memory>
+    #include <utility>
+    #include <vector>
     #include "ast.hpp"
+    #include "lexer.hpp"
+
+    // 语法分析的中间状态, 每次解析各自持有一份
+    struct ParseState
+    {
+        Lexer &lexer;
+        std::vector<std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>> inst_vec;
+        std::vector<std::unique_ptr<BaseAST>> func_vec, fparams, arr_size;
+        std::vector<std::vector<std::unique_ptr<BaseAST>>> rparams, idx_vec, arr_vec;
+
+        ParseState(Lexer &_lexer) : lexer(_lexer)
+        {
+            return;
+        }
+
+        void add_inst(InstType inst_type, BaseAST *ast)
+        {
+            inst_vec.back().push_back(make_pair(inst_type, std::unique_ptr<BaseAST>(ast)));
+
+            return;
+        }
+    };
+}
+
+%code provides
+{
+    // 声明 lexer 函数
+    int yylex(YYSTYPE *lval, ParseState &state);
 }
 
 %{
 
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include "ast.hpp"
 
-static std::vector<std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>> inst_vec;
-static std::vector<std::unique_ptr<BaseAST>> func_vec, fparams, arr_size;
-static std::vector<std::vector<std::unique_ptr<BaseAST>>> rparams, idx_vec, arr_vec;
+%}
 
-void add_inst(InstType inst_type, BaseAST *ast)
+%code
 {
-    inst_vec.back().push_back(make_pair(inst_type, std::unique_ptr<BaseAST>(ast)));
-
-    return;
+    // 声明错误处理函数
+    void yyerror(std::unique_ptr<BaseAST> &ast, ParseState &state, const char *s);
 }
 
-// 声明 lexer 函数和错误处理函数
-int yylex();
-void yyerror(std::unique_ptr<BaseAST> &ast, const char *s);
-
-%}
+// 生成可重入的 parser, token 的值通过参数传递而不是全局变量 yylval
+%define api.pure full
 
 // 定义 parser 函数和错误处理函数的附加参数
 // 我们需要返回一个字符串作为 AST, 所以我们把附加参数定义成字符串的智能指针
 // 解析完成后, 我们要手动修改这个参数, 把它设置成解析得到的字符串
-%parse-param { std::unique_ptr<BaseAST> &ast }
+%parse-param { std::unique_ptr<BaseAST> &ast } { ParseState &state }
+%lex-param { ParseState &state }
 
 // yylval 的定义, 我们把它定义成了一个联合体 (union)
 // 因为 token 的值有的是字符串指针, 有的是整数
@@ -40,7 +67,7 @@ void yyerror(std::unique_ptr<BaseAST> &ast, const char *s);
 // 请自行 STFW 在 union 里写一个带析构函数的类会出现什么情况
 %union
 {
-    std::string *str_val;
+    const std::string *str_val;
     int int_val;
     BaseAST *ast_val;
 }
@@ -48,8 +75,8 @@ void yyerror(std::unique_ptr<BaseAST> &ast, const char *s);
 // lexer 返回的所有 token 种类的声明
 // 注意 IDENT 和 INT_CONST 会返回 token 的值, 分别对应 str_val 和 int_val
 %token INT VOID RETURN CONST IF ELSE _WHILE _BREAK _CONTINUE
-%token <str_val> IDENT UNARYOP MULOP ADDOP RELOP EQOP LANDOP LOROP
-%token <int_val> INT_CONST
+%token <str_val> IDENT
+%token <int_val> UNARYOP MULOP ADDOP RELOP EQOP LANDOP LOROP INT_CONST
 
 // 非终结符的类型定义
 %type <ast_val> FuncDef FuncType Block IfExp
@@ -67,21 +94,21 @@ void yyerror(std::unique_ptr<BaseAST> &ast, const char *s);
 
 CompUnit:
 {
-    inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
+    state.inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
 }
 GlobalList
 {
-    ast = std::unique_ptr<BaseAST>(new CompUnitAST(func_vec, inst_vec.back()));
-    inst_vec.pop_back();
+    ast = std::unique_ptr<BaseAST>(new CompUnitAST(state.func_vec, state.inst_vec.back()));
+    state.inst_vec.pop_back();
 };
 
 GlobalList: FuncDef
 {
-    func_vec.push_back(std::unique_ptr<BaseAST>($1));
+    state.func_vec.push_back(std::unique_ptr<BaseAST>($1));
 }
 | GlobalList FuncDef
 {
-    func_vec.push_back(std::unique_ptr<BaseAST>($2));
+    state.func_vec.push_back(std::unique_ptr<BaseAST>($2));
 }
 | Decl | GlobalList Decl ;
 
@@ -97,22 +124,22 @@ GlobalList: FuncDef
 // 这种写法会省下很多内存管理的负担
 FuncDef: FuncType IDENT '('
 {
-    fparams.clear();
+    state.fparams.clear();
 }
 FuncFParams ')' Block
 {
     auto type = std::unique_ptr<BaseAST>($1);
-    auto ident = std::unique_ptr<std::string>($2);
+    auto ident = $2;
     auto block = std::unique_ptr<BaseAST>($7);
-    $$ = new FuncDefAST(type, *ident, fparams, block);
+    $$ = new FuncDefAST(type, *ident, state.fparams, block);
 }
 | FuncType IDENT '(' ')' Block
 {
     auto type = std::unique_ptr<BaseAST>($1);
-    auto ident = std::unique_ptr<std::string>($2);
+    auto ident = $2;
     auto block = std::unique_ptr<BaseAST>($5);
-    fparams.clear();
-    $$ = new FuncDefAST(type, *ident, fparams, block);
+    state.fparams.clear();
+    $$ = new FuncDefAST(type, *ident, state.fparams, block);
 };
 
 FuncType: INT
@@ -127,29 +154,29 @@ FuncType: INT
 FuncFParams: FuncFParam | FuncFParams ',' FuncFParam;
 FuncFParam: INT IDENT
 {
-    auto ident = std::unique_ptr<std::string>($2);
-    fparams.push_back(std::make_unique<FuncFParamAST>(FuncFParamAST::INT, *ident, fparams.size()));
+    auto ident = $2;
+    state.fparams.push_back(std::make_unique<FuncFParamAST>(FuncFParamAST::INT, *ident, state.fparams.size()));
 }
 | INT IDENT '[' ']'
 {
-    auto ident = std::unique_ptr<std::string>($2);
-    fparams.push_back(std::make_unique<FuncFParamAST>(FuncFParamAST::ARRAY, *ident, fparams.size(), arr_size));
+    auto ident = $2;
+    state.fparams.push_back(std::make_unique<FuncFParamAST>(FuncFParamAST::ARRAY, *ident, state.fparams.size(), state.arr_size));
 }
 | INT IDENT '[' ']' ArraySizeList
 {
-    auto ident = std::unique_ptr<std::string>($2);
-    fparams.push_back(std::make_unique<FuncFParamAST>(FuncFParamAST::ARRAY, *ident, fparams.size(), arr_size));
-    arr_size.clear();
+    auto ident = $2;
+    state.fparams.push_back(std::make_unique<FuncFParamAST>(FuncFParamAST::ARRAY, *ident, state.fparams.size(), state.arr_size));
+    state.arr_size.clear();
 };
 
 Block: '{'
 {
-    inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
+    state.inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
 }
 BlockItems '}'
 {
-    $$ = new BlockAST(inst_vec.back());
-    inst_vec.pop_back();
+    $$ = new BlockAST(state.inst_vec.back());
+    state.inst_vec.pop_back();
 }
 | '{' '}'
 {
@@ -162,76 +189,76 @@ BlockItem: Decl | Stmt;
 
 Stmt: RETURN ';'
 {
-    add_inst(InstType::STMT, new ReturnAST());
+    state.add_inst(InstType::STMT, new ReturnAST());
 }
 | RETURN Exp ';'
 {
     auto val = std::unique_ptr<BaseAST>($2);
-    add_inst(InstType::STMT, new ReturnAST(val));
+    state.add_inst(InstType::STMT, new ReturnAST(val));
 }
 | LVal '=' Exp ';'
 {
     auto lval = std::unique_ptr<BaseAST>($1);
     auto exp = std::unique_ptr<BaseAST>($3);
-    add_inst(InstType::STMT, new AssignmentAST(lval, exp));
+    state.add_inst(InstType::STMT, new AssignmentAST(lval, exp));
 }
 | ';' | Exp ';'
 {
-    add_inst(InstType::STMT, $1);
+    state.add_inst(InstType::STMT, $1);
 }
 | Block
 {
-    add_inst(InstType::STMT, $1);
+    state.add_inst(InstType::STMT, $1);
 }
 | IfExp Stmt
 {
     auto exp = std::unique_ptr<BaseAST>($1);
     std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>> true_insts;
-    for(auto &insts : inst_vec.back())
+    for(auto &insts : state.inst_vec.back())
         true_insts.push_back(std::make_pair(insts.first, std::move(insts.second)));
-    inst_vec.pop_back();
-    add_inst(InstType::BRANCH, new BranchAST(exp, true_insts));
+    state.inst_vec.pop_back();
+    state.add_inst(InstType::BRANCH, new BranchAST(exp, true_insts));
 }
 | IfExp Stmt ELSE
 {
-    inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
+    state.inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
 }
 Stmt
 {
     auto exp = std::unique_ptr<BaseAST>($1);
     std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>> true_insts, false_insts;
-    for(auto &insts : inst_vec.rbegin()[1])
+    for(auto &insts : state.inst_vec.rbegin()[1])
         true_insts.push_back(std::make_pair(insts.first, std::move(insts.second)));
-    for(auto &insts : inst_vec.back())
+    for(auto &insts : state.inst_vec.back())
         false_insts.push_back(std::make_pair(insts.first, std::move(insts.second)));
-    inst_vec.erase(inst_vec.end() - 2, inst_vec.end());
-    add_inst(InstType::BRANCH, new BranchAST(exp, true_insts, false_insts));
+    state.inst_vec.erase(state.inst_vec.end() - 2, state.inst_vec.end());
+    state.add_inst(InstType::BRANCH, new BranchAST(exp, true_insts, false_insts));
 }
 | _WHILE '(' Exp ')'
 {
-    inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
+    state.inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
 }
 Stmt
 {
     auto exp = std::unique_ptr<BaseAST>($3);
     std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>> body_insts;
-    for(auto &insts : inst_vec.back())
+    for(auto &insts : state.inst_vec.back())
         body_insts.push_back(std::make_pair(insts.first, std::move(insts.second)));
-    inst_vec.pop_back();
-    add_inst(InstType::WHILE, new WhileAST(exp, body_insts));
+    state.inst_vec.pop_back();
+    state.add_inst(InstType::WHILE, new WhileAST(exp, body_insts));
 }
 | _BREAK ';'
 {
-    add_inst(InstType::BREAK, new BreakAST());
+    state.add_inst(InstType::BREAK, new BreakAST());
 }
 | _CONTINUE ';'
 {
-    add_inst(InstType::CONTINUE, new ContinueAST());
+    state.add_inst(InstType::CONTINUE, new ContinueAST());
 };
 
 IfExp: IF '(' Exp ')'
 {
-    inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
+    state.inst_vec.push_back(std::vector<std::pair<InstType, std::unique_ptr<BaseAST>>>());
     $$ = $3;
 };
 
@@ -241,49 +268,49 @@ ConstDecl: CONST FuncType ConstDefList ';';
 ConstDefList: ConstDef | ConstDefList ',' ConstDef
 ConstDef: IDENT '=' Exp
 {
-    auto ident = std::unique_ptr<std::string>($1);
+    auto ident = $1;
     auto exp = std::unique_ptr<BaseAST>($3);
-    add_inst(InstType::CONSTDECL, new ConstDefAST(*ident, exp));
+    state.add_inst(InstType::CONSTDECL, new ConstDefAST(*ident, exp));
 }
 | IDENT ArraySizeList '=' InitVal
 {
-    auto ident = std::unique_ptr<std::string>($1);
+    auto ident = $1;
     auto initval = std::unique_ptr<BaseAST>($4);
-    add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, arr_size, initval));
-    arr_size.clear();
+    state.add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, state.arr_size, initval));
+    state.arr_size.clear();
 };
 | IDENT ArraySizeList
 {
-    auto ident = std::unique_ptr<std::string>($1);
-    add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, arr_size));
-    arr_size.clear();
+    auto ident = $1;
+    state.add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, state.arr_size));
+    state.arr_size.clear();
 };
 
 VarDecl: FuncType VarDefList ';';
 VarDefList: VarDef | VarDefList ',' VarDef
 VarDef: IDENT
 {
-    auto ident = std::unique_ptr<std::string>($1);
-    add_inst(InstType::DECL, new VarDefAST(*ident));
+    auto ident = $1;
+    state.add_inst(InstType::DECL, new VarDefAST(*ident));
 }
 | IDENT '=' Exp
 {
-    auto ident = std::unique_ptr<std::string>($1);
+    auto ident = $1;
     auto exp = std::unique_ptr<BaseAST>($3);
-    add_inst(InstType::DECL, new VarDefAST(*ident, exp));
+    state.add_inst(InstType::DECL, new VarDefAST(*ident, exp));
 }
 | IDENT ArraySizeList '=' InitVal
 {
-    auto ident = std::unique_ptr<std::string>($1);
+    auto ident = $1;
     auto initval = std::unique_ptr<BaseAST>($4);
-    add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, arr_size, initval));
-    arr_size.clear();
+    state.add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, state.arr_size, initval));
+    state.arr_size.clear();
 };
 | IDENT ArraySizeList
 {
-    auto ident = std::unique_ptr<std::string>($1);
-    add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, arr_size));
-    arr_size.clear();
+    auto ident = $1;
+    state.add_inst(InstType::ARRAYDECL, new ArrayDefAST(*ident, state.arr_size));
+    state.arr_size.clear();
 };
 
 ArraySizeList: ArraySize | ArraySizeList ArraySize;
@@ -291,7 +318,7 @@ ArraySizeList: ArraySize | ArraySizeList ArraySize;
 ArraySize: '[' Exp ']'
 {
     auto exp = std::unique_ptr<BaseAST>($2);
-    arr_size.push_back(std::move(exp));
+    state.arr_size.push_back(std::move(exp));
 };
 
 InitVal: Exp
@@ -301,45 +328,45 @@ InitVal: Exp
 }
 | '{'
 {
-    arr_vec.push_back(std::vector<std::unique_ptr<BaseAST>>());
+    state.arr_vec.push_back(std::vector<std::unique_ptr<BaseAST>>());
 }
 ArrInitList '}'
 {
-    $$ = new InitValAST(arr_vec.back());
-    arr_vec.pop_back();
+    $$ = new InitValAST(state.arr_vec.back());
+    state.arr_vec.pop_back();
 }
 | '{' '}'
 {
-    arr_vec.push_back(std::vector<std::unique_ptr<BaseAST>>());
-    $$ = new InitValAST(arr_vec.back());
-    arr_vec.pop_back();
+    state.arr_vec.push_back(std::vector<std::unique_ptr<BaseAST>>());
+    $$ = new InitValAST(state.arr_vec.back());
+    state.arr_vec.pop_back();
 };
 
 ArrInitList: InitVal
 {
     auto initval = std::unique_ptr<BaseAST>($1);
-    arr_vec.back().push_back(std::move(initval));
+    state.arr_vec.back().push_back(std::move(initval));
 }
 | ArrInitList ',' InitVal
 {
     auto initval = std::unique_ptr<BaseAST>($3);
-    arr_vec.back().push_back(std::move(initval));
+    state.arr_vec.back().push_back(std::move(initval));
 };
 
 LVal: IDENT
 {
-    auto ident = std::unique_ptr<std::string>($1);
+    auto ident = $1;
     $$ = new LValAST(*ident);
 }
 | IDENT
 {
-    idx_vec.push_back(std::vector<std::unique_ptr<BaseAST>>());
+    state.idx_vec.push_back(std::vector<std::unique_ptr<BaseAST>>());
 }
 IndexList
 {
-    auto ident = std::unique_ptr<std::string>($1);
-    $$ = new LValAST(*ident, idx_vec.back());
-    idx_vec.pop_back();
+    auto ident = $1;
+    $$ = new LValAST(*ident, state.idx_vec.back());
+    state.idx_vec.pop_back();
 };
 
 IndexList: Index | IndexList Index
@@ -347,7 +374,7 @@ IndexList: Index | IndexList Index
 Index: '[' Exp ']'
 {
     auto exp = std::unique_ptr<BaseAST>($2);
-    idx_vec.back().push_back(std::move(exp));
+    state.idx_vec.back().push_back(std::move(exp));
 }
 
 Exp: LOrExp
@@ -379,38 +406,38 @@ UnaryExp: PrimaryExp
 }
 | UNARYOP UnaryExp
 {
-    auto op = std::unique_ptr<std::string>($1);
+    auto op = (OpType)$1;
     auto unary_exp = std::unique_ptr<BaseAST>($2);
-    $$ = new UnaryExpAST(*op, unary_exp);
+    $$ = new UnaryExpAST(op, unary_exp);
 }
 | ADDOP UnaryExp
 {
-    auto op = std::unique_ptr<std::string>($1);
+    auto op = (OpType)$1;
     auto unary_exp = std::unique_ptr<BaseAST>($2);
-    $$ = new UnaryExpAST(*op, unary_exp);
+    $$ = new UnaryExpAST(op, unary_exp);
 }
 | IDENT '('
 {
-    rparams.push_back(std::vector<std::unique_ptr<BaseAST>>());
+    state.rparams.push_back(std::vector<std::unique_ptr<BaseAST>>());
 }
 FuncRParams ')'
 {
-    auto ident = std::unique_ptr<std::string>($1);
-    $$ = new UnaryExpAST(*ident, rparams.back());
-    rparams.pop_back();
+    auto ident = $1;
+    $$ = new UnaryExpAST(*ident, state.rparams.back());
+    state.rparams.pop_back();
 }
 | IDENT '(' ')'
 {
-    auto ident = std::unique_ptr<std::string>($1);
-    rparams.push_back(std::vector<std::unique_ptr<BaseAST>>());
-    $$ = new UnaryExpAST(*ident, rparams.back());
-    rparams.pop_back();
+    auto ident = $1;
+    state.rparams.push_back(std::vector<std::unique_ptr<BaseAST>>());
+    $$ = new UnaryExpAST(*ident, state.rparams.back());
+    state.rparams.pop_back();
 };
 
 FuncRParams: FuncRParam | FuncRParams ',' FuncRParam;
 FuncRParam: Exp
 {
-    rparams.back().push_back(std::unique_ptr<BaseAST>($1));
+    state.rparams.back().push_back(std::unique_ptr<BaseAST>($1));
 }
 
 MulExp: UnaryExp
@@ -421,9 +448,9 @@ MulExp: UnaryExp
 | MulExp MULOP UnaryExp
 {
     auto left_exp = std::unique_ptr<BaseAST>($1);
-    auto op = std::unique_ptr<std::string>($2);
+    auto op = (OpType)$2;
     auto right_exp = std::unique_ptr<BaseAST>($3);
-    $$ = new MulExpAST(left_exp, *op, right_exp);
+    $$ = new MulExpAST(left_exp, op, right_exp);
 };
 
 AddExp: MulExp
@@ -434,9 +461,9 @@ AddExp: MulExp
 | AddExp ADDOP MulExp
 {
     auto left_exp = std::unique_ptr<BaseAST>($1);
-    auto op = std::unique_ptr<std::string>($2);
+    auto op = (OpType)$2;
     auto right_exp = std::unique_ptr<BaseAST>($3);
-    $$ = new AddExpAST(left_exp, *op, right_exp);
+    $$ = new AddExpAST(left_exp, op, right_exp);
 };
 
 RelExp: AddExp
@@ -447,9 +474,9 @@ RelExp: AddExp
 | RelExp RELOP AddExp
 {
     auto left_exp = std::unique_ptr<BaseAST>($1);
-    auto op = std::unique_ptr<std::string>($2);
+    auto op = (OpType)$2;
     auto right_exp = std::unique_ptr<BaseAST>($3);
-    $$ = new RelExpAST(left_exp, *op, right_exp);
+    $$ = new RelExpAST(left_exp, op, right_exp);
 };
 
 EqExp: RelExp
@@ -460,9 +487,9 @@ EqExp: RelExp
 | EqExp EQOP RelExp
 {
     auto left_exp = std::unique_ptr<BaseAST>($1);
-    auto op = std::unique_ptr<std::string>($2);
+    auto op = (OpType)$2;
     auto right_exp = std::unique_ptr<BaseAST>($3);
-    $$ = new EqExpAST(left_exp, *op, right_exp);
+    $$ = new EqExpAST(left_exp, op, right_exp);
 };
 
 LAndExp: EqExp
@@ -473,9 +500,9 @@ LAndExp: EqExp
 | LAndExp LANDOP EqExp
 {
     auto left_exp = std::unique_ptr<BaseAST>($1);
-    auto op = std::unique_ptr<std::string>($2);
+    auto op = (OpType)$2;
     auto right_exp = std::unique_ptr<BaseAST>($3);
-    $$ = new LAndExpAST(left_exp, *op, right_exp);
+    $$ = new LAndExpAST(left_exp, op, right_exp);
 };
 
 LOrExp: LAndExp
@@ -486,9 +513,9 @@ LOrExp: LAndExp
 | LOrExp LOROP LAndExp
 {
     auto left_exp = std::unique_ptr<BaseAST>($1);
-    auto op = std::unique_ptr<std::string>($2);
+    auto op = (OpType)$2;
     auto right_exp = std::unique_ptr<BaseAST>($3);
-    $$ = new LOrExpAST(left_exp, *op, right_exp);
+    $$ = new LOrExpAST(left_exp, op, right_exp);
 };
 
 Number: INT_CONST
@@ -498,10 +525,10 @@ Number: INT_CONST
 
 %%
 
-// 定义错误处理函数, 其中第二个参数是错误信息
+// 定义错误处理函数, 其中最后一个参数是错误信息
 // parser 如果发生错误 (例如输入的程序出现了语法错误), 就会调用这个函数
-void yyerror(std::unique_ptr<BaseAST> &ast, const char *s)
+// 错误以异常的形式抛出, 由调用者决定如何处理
+void yyerror(std::unique_ptr<BaseAST> &ast, ParseState &state, const char *s)
 {
-    std::cerr << "error: " << s << std::endl;
-    exit(0);
+    throw std::runtime_error("error: " + std::string(s));
 }
@@ -1,36 +1,97 @@
 #include <algorithm>
+#include <functional>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include "ast.hpp"
 #include "koopa.h"
 #include "table.hpp"
 
+void SymbolList::rehash(void)
+{
+    std::vector<int> old(slots.empty() ? 64 : slots.size() * 2, -1);
+
+    old.swap(slots);
+    for(int id = 0; id < (int)names.size(); id ++)
+    {
+        size_t pos = std::hash<std::string>()(names[id]) & (slots.size() - 1);
+        while(slots[pos] != -1)
+            pos = (pos + 1) & (slots.size() - 1);
+        slots[pos] = id;
+    }
+
+    return;
+}
+
+int SymbolList::intern(const std::string &name)
+{
+    if((names.size() + 1) * 2 > slots.size())
+        rehash();
+
+    size_t pos = std::hash<std::string>()(name) & (slots.size() - 1);
+    while(slots[pos] != -1)
+    {
+        if(names[slots[pos]] == name)
+            return slots[pos];
+        pos = (pos + 1) & (slots.size() - 1);
+    }
+
+    slots[pos] = names.size();
+    names.push_back(name);
+    heads.push_back(-1);
+
+    return slots[pos];
+}
+
 void SymbolList::new_scope(void)
 {
-    table.push_back(std::map<std::string, LVal>());
+    scopes.push_back(bindings.size());
+
+    return;
+}
+
+void SymbolList::add_symbol(int id, LVal koopa_item)
+{
+    if(heads[id] != -1 && heads[id] >= scopes.back())
+    {
+        bindings[heads[id]].item = koopa_item;
+        return;
+    }
+
+    bindings.push_back({koopa_item, id, heads[id]});
+    heads[id] = bindings.size() - 1;
 
     return;
 }
 
 void SymbolList::add_symbol(const std::string &name, LVal koopa_item)
 {
-    table.back()[name] = koopa_item;
+    add_symbol(intern(name), koopa_item);
 
     return;
 }
 
-LVal SymbolList::get_symbol(const std::string &name)
+LVal SymbolList::get_symbol(int id)
 {
-    for(auto page = table.rbegin(); page != table.rend(); page ++)
-        if(page->count(name))
-            return (*page)[name];
+    if(heads[id] == -1)
+        throw std::runtime_error("error: cannot find " + names[id] + " in symbol table");
 
-    throw("error: cannot find " + name + " in symbol table");
+    return bindings[heads[id]].item;
+}
+
+LVal SymbolList::get_symbol(const std::string &name)
+{
+    return get_symbol(intern(name));
 }
 
 void SymbolList::end_scope(void)
 {
-    table.pop_back();
+    while((int)bindings.size() > scopes.back())
+    {
+        heads[bindings.back().id] = bindings.back().shadow;
+        bindings.pop_back();
+    }
+    scopes.pop_back();
 
     return;
 }
@@ -38,6 +99,7 @@ void SymbolList::end_scope(void)
 void BlockInst::set_block(std::vector<void *> *_block)
 {
     block = _block;
+    label = 0;
 
     return;
 }
@@ -45,6 +107,9 @@ void BlockInst::set_block(std::vector<void *> *_block)
 void BlockInst::new_block(koopa_raw_basic_block_data_t *basic)
 {
     end_block();
+    if(label)
+        basic->name = BaseAST().string_data(std::string(basic->name) + "_" + std::to_string(label));
+    label ++;
     basic->insts.buffer = nullptr;
     block->push_back(basic);
 
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <map>
 #include <string>
 #include <vector>
 #include "koopa.h"
@@ -19,16 +18,34 @@ struct LVal
     void *number;
 };
 
+// 作用域符号表: 标识符先唯一化为整数 id, 每个 id 的同名绑定串成遮蔽链
 class SymbolList
 {
 private:
-    std::vector<std::map<std::string, LVal>> table;
+    struct Binding
+    {
+        LVal item;
+        int id;
+        int shadow;
+    };
+
+    std::vector<int> slots;
+    std::vector<std::string> names;
+    std::vector<int> heads;
+    std::vector<Binding> bindings;
+    std::vector<int> scopes;
+
+    void rehash(void);
 
 public:
+    int intern(const std::string &name);
+
     void new_scope(void);
     void end_scope(void);
 
+    void add_symbol(int id, LVal koopa_item);
     void add_symbol(const std::string &name, LVal koopa_item);
+    LVal get_symbol(int id);
     LVal get_symbol(const std::string &name);
 };
 
@@ -36,6 +53,7 @@ class BlockInst
 {
 private:
     std::vector<void *> current, *block;
+    int label;
 
 public:
     void set_block(std::vector<void *> *_block);
@@ -0,0 +1,67 @@
+#include <vector>
+#include "arena.hpp"
+#include "koopa.h"
+#include "type_table.hpp"
+
+TypeTable::TypeTable(Arena &_arena) : arena(_arena), int32_type(nullptr), unit_type(nullptr)
+{
+    return;
+}
+
+koopa_raw_type_t TypeTable::int32(void)
+{
+    if(!int32_type)
+        int32_type = arena.make(koopa_raw_type_kind{.tag = KOOPA_RTT_INT32});
+
+    return int32_type;
+}
+
+koopa_raw_type_t TypeTable::unit(void)
+{
+    if(!unit_type)
+        unit_type = arena.make(koopa_raw_type_kind{.tag = KOOPA_RTT_UNIT});
+
+    return unit_type;
+}
+
+koopa_raw_type_t TypeTable::pointer(koopa_raw_type_t base)
+{
+    auto &res = pointers[base];
+    if(!res)
+        res = arena.make(koopa_raw_type_kind{.tag = KOOPA_RTT_POINTER, .data.pointer.base = base});
+
+    return res;
+}
+
+koopa_raw_type_t TypeTable::array(koopa_raw_type_t base, size_t len)
+{
+    auto &res = arrays[{base, len}];
+    if(!res)
+        res = arena.make(koopa_raw_type_kind{.tag = KOOPA_RTT_ARRAY, .data.array.base = base, .data.array.len = len});
+
+    return res;
+}
+
+koopa_raw_type_t TypeTable::function(const std::vector<koopa_raw_type_t> &params, koopa_raw_type_t ret)
+{
+    auto &res = functions[{params, ret}];
+    if(!res)
+    {
+        std::vector<void *> vec;
+        for(auto ty : params)
+            vec.push_back((void *)ty);
+        res = arena.make(koopa_raw_type_kind{.tag = KOOPA_RTT_FUNCTION, .data.function.params = {arena.slice(vec), (unsigned)vec.size(), KOOPA_RSIK_TYPE}, .data.function.ret = ret});
+    }
+
+    return res;
+}
+
+void TypeTable::clear(void)
+{
+    int32_type = unit_type = nullptr;
+    pointers.clear();
+    arrays.clear();
+    functions.clear();
+
+    return;
+}
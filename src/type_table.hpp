@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "arena.hpp"
+#include "koopa.h"
+
+// Koopa 类型的唯一化表: 每种类型只存在一份, 类型相等即指针相等
+class TypeTable
+{
+private:
+    struct ArrayKey
+    {
+        koopa_raw_type_t base;
+        size_t len;
+
+        bool operator==(const ArrayKey &other) const
+        {
+            return base == other.base && len == other.len;
+        }
+    };
+
+    struct ArrayHash
+    {
+        size_t operator()(const ArrayKey &key) const
+        {
+            return std::hash<koopa_raw_type_t>()(key.base) * 31 + std::hash<size_t>()(key.len);
+        }
+    };
+
+    Arena &arena;
+    koopa_raw_type_t int32_type, unit_type;
+    std::unordered_map<koopa_raw_type_t, koopa_raw_type_t> pointers;
+    std::unordered_map<ArrayKey, koopa_raw_type_t, ArrayHash> arrays;
+    std::map<std::pair<std::vector<koopa_raw_type_t>, koopa_raw_type_t>, koopa_raw_type_t> functions;
+
+public:
+    TypeTable(Arena &_arena);
+
+    koopa_raw_type_t int32(void);
+    koopa_raw_type_t unit(void);
+    koopa_raw_type_t pointer(koopa_raw_type_t base);
+    koopa_raw_type_t array(koopa_raw_type_t base, size_t len);
+    koopa_raw_type_t function(const std::vector<koopa_raw_type_t> &params, koopa_raw_type_t ret);
+
+    void clear(void);
+};
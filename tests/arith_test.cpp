@@ -0,0 +1,175 @@
+#include <climits>
+#include <cstdio>
+#include <exception>
+#include <random>
+#include <vector>
+#include "arith.hpp"
+#include "mir.hpp"
+#include "mir_interp.hpp"
+
+// 随机数种子固定, 每次运行检查同样的用例
+static std::mt19937 rng(20240917);
+
+// RISC-V 的 div 和 rem: INT_MIN / -1 溢出为 INT_MIN, 余数为 0
+static int reference(int x, int c, bool mod)
+{
+    if(x == INT_MIN && c == -1)
+        return mod ? 0 : INT_MIN;
+
+    return mod ? x % c : x / c;
+}
+
+static std::vector<int> divisors(void)
+{
+    std::vector<int> res;
+
+    for(int c = -1024; c <= 1024; c ++)
+        if(c)
+            res.push_back(c);
+    for(int k = 0; k < 31; k ++)
+        for(int c : {1 << k, -(1 << k), (1 << k) + 1, -(1 << k) - 1, (1 << k) - 1, 1 - (1 << k)})
+            if(c)
+                res.push_back(c);
+    for(int c : {INT_MIN, INT_MAX, INT_MIN + 1, 1000000007, -1000000007, 641, 6700417})
+        res.push_back(c);
+    for(int i = 0; i < 3000; i ++)
+    {
+        int c = (int)rng();
+        if(c)
+            res.push_back(c);
+    }
+
+    return res;
+}
+
+static std::vector<int> dividends(int c)
+{
+    std::vector<int> res = {0, 1, -1, 2, -2, INT_MAX, INT_MIN, INT_MAX - 1, INT_MIN + 1};
+    long long edges[] = {c, -(long long)c, c - 1LL, c + 1LL, 1LL - c, -1LL - c, (long long)INT_MAX / c * c, (long long)INT_MIN / c * c};
+
+    for(long long x : edges)
+        for(long long d = -1; d <= 1; d ++)
+            if(x + d >= INT_MIN && x + d <= INT_MAX)
+                res.push_back((int)(x + d));
+    for(int i = 0; i < 200; i ++)
+        res.push_back((int)rng());
+    for(int i = 0; i < 100; i ++)
+        res.push_back((int)(rng() % 200001) - 100000);
+
+    return res;
+}
+
+// 除以和对常数取余展开后的序列与 div/rem 的结果一致
+static bool div_rem(void)
+{
+    bool ok = true;
+
+    for(int c : divisors())
+        for(bool mod : {false, true})
+        {
+            MFunc func("div_rem");
+            std::vector<MInst> insts;
+            int lhs = func.vreg(), dst = func.vreg();
+            if(!div_const(func, insts, mod, lhs, c, dst))
+                continue;
+
+            Interp interp(func.vreg_count());
+            for(int x : dividends(c))
+            {
+                interp.set(lhs, x);
+                interp.run(insts);
+                if(interp.get(dst) != reference(x, c, mod))
+                {
+                    std::fprintf(stderr, "%d %s %d: got %d, expected %d\n", x, mod ? "%" : "/", c, interp.get(dst), reference(x, c, mod));
+                    ok = false;
+                    break;
+                }
+            }
+        }
+
+    return ok;
+}
+
+// 乘以常数展开后的序列与 mul 的结果一致
+static bool mul(void)
+{
+    bool ok = true;
+
+    for(int c : divisors())
+    {
+        MFunc func("mul");
+        std::vector<MInst> insts;
+        int lhs = func.vreg(), dst = func.vreg();
+        if(!mul_const(func, insts, lhs, c, dst))
+            continue;
+
+        Interp interp(func.vreg_count());
+        for(int x : dividends(c))
+        {
+            int expected = (int)((unsigned)x * (unsigned)c);
+            interp.set(lhs, x);
+            interp.run(insts);
+            if(interp.get(dst) != expected)
+            {
+                std::fprintf(stderr, "%d * %d: got %d, expected %d\n", x, c, interp.get(dst), expected);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    return ok;
+}
+
+// 魔数满足 x / d = (mulh(x, M) [+- x]) >> s 再对负数加 1 所需的范围
+static bool magic_range(void)
+{
+    for(int c : divisors())
+    {
+        unsigned m = c < 0 ? 0U - (unsigned)c : (unsigned)c;
+        if(m < 2 || m == 1U << 31)
+            continue;
+        int shift = -1;
+        magic(c, shift);
+        if(shift < 0 || shift > 31)
+        {
+            std::fprintf(stderr, "magic(%d): shift %d\n", c, shift);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *name;
+        bool (*run)(void);
+    } tests[] = {
+        {"div_rem", div_rem},
+        {"mul", mul},
+        {"magic_range", magic_range}
+    };
+    int failed = 0;
+
+    for(auto &test : tests)
+    {
+        bool ok;
+        try
+        {
+            ok = test.run();
+        }
+        catch(const std::exception &e)
+        {
+            std::fprintf(stderr, "%s: %s\n", test.name, e.what());
+            ok = false;
+        }
+        if(!ok)
+            failed ++;
+        std::printf("%s %s\n", ok ? "ok" : "FAIL", test.name);
+    }
+
+    return failed ? 1 : 0;
+}
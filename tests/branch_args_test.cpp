@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include "ast.hpp"
+#include "context.hpp"
+#include "koopa.h"
+#include "lexer.hpp"
+#include "output.hpp"
+#include "riscv.hpp"
+#include "schedule.hpp"
+#include "sysy.tab.hpp"
+
+static const char *PROGRAM =
+    "int f(int a, int b, int c) {\n"
+    "  int t = a < b;\n"
+    "  if (c) t = 0;\n"
+    "  return t;\n"
+    "}\n"
+    "int main() {\n"
+    "  return f(1, 2, 0);\n"
+    "}\n";
+
+static std::string read_file(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream res;
+    res << in.rdbuf();
+
+    return res.str();
+}
+
+// 把入口块的 br @c, %true, %false 中只有一条 jump %end(%0) 的 %false 合并进 br:
+// 得到 br @c, %true, %end(%0), 比较 %0 只作为 br 的块参数使用
+static bool thread_false_block(koopa_raw_function_data_t *kfunc)
+{
+    auto kentry = (koopa_raw_basic_block_data_t *)kfunc->bbs.buffer[0];
+    auto kbranch = (koopa_raw_value_data_t *)kentry->insts.buffer[kentry->insts.len - 1];
+    if(kbranch->kind.tag != KOOPA_RVT_BRANCH)
+        return false;
+    auto kfalse = kbranch->kind.data.branch.false_bb;
+    auto kjump = (koopa_raw_value_t)kfalse->insts.buffer[0];
+    if(kfalse->insts.len != 1 || kjump->kind.tag != KOOPA_RVT_JUMP || kjump->kind.data.jump.args.len != 1)
+        return false;
+    auto kcmp = (koopa_raw_value_data_t *)kjump->kind.data.jump.args.buffer[0];
+    if(kcmp->kind.tag != KOOPA_RVT_BINARY || kcmp->kind.data.binary.op != KOOPA_RBO_LT)
+        return false;
+
+    kbranch->kind.data.branch.false_bb = kjump->kind.data.jump.target;
+    kbranch->kind.data.branch.false_args = kjump->kind.data.jump.args;
+    kcmp->used_by.buffer[0] = kbranch;
+
+    int n = 0;
+    for(int i = 0; i < (int)kfunc->bbs.len; i ++)
+        if(kfunc->bbs.buffer[i] != kfalse)
+            kfunc->bbs.buffer[n ++] = kfunc->bbs.buffer[i];
+    kfunc->bbs.len = n;
+
+    return true;
+}
+
+// 只作为块参数传递的比较不能和 br 融合, 必须先算出结果
+int main(void)
+{
+    std::string input = "/tmp/branch_args_test_" + std::to_string(getpid()) + ".sy";
+    std::ofstream(input) << PROGRAM;
+
+    int failed = 0;
+    try
+    {
+        Context context;
+        Lexer lexer(input.c_str());
+        ParseState state(lexer);
+        std::unique_ptr<BaseAST> ast;
+        yyparse(ast, state);
+
+        std::unique_ptr<CompUnitAST> comp_ast((CompUnitAST *)ast.release());
+        koopa_raw_program_t krp = comp_ast->to_koopa_program();
+
+        koopa_raw_function_data_t *kfunc = nullptr;
+        for(int i = 0; i < (int)krp.funcs.len; i ++)
+            if(!strcmp(((koopa_raw_function_t)krp.funcs.buffer[i])->name, "@f"))
+                kfunc = (koopa_raw_function_data_t *)krp.funcs.buffer[i];
+        if(!kfunc || !thread_false_block(kfunc))
+        {
+            std::fprintf(stderr, "branch_args_test: unexpected IR for the test program\n");
+            failed ++;
+        }
+        else
+        {
+            std::string path = input + ".S";
+            Output out(path.c_str());
+            koopa2riscv(&krp, out, find_pipeline("generic"), 1);
+            out.close();
+            std::string res = read_file(path);
+            unlink(path.c_str());
+
+            std::string body = res.substr(0, res.find("\nmain:"));
+            if(body.find("slt") == std::string::npos)
+            {
+                std::fprintf(stderr, "branch_args_test: a < b is never computed\n");
+                failed ++;
+            }
+        }
+    }
+    catch(const std::exception &e)
+    {
+        std::fprintf(stderr, "branch_args_test: %s\n", e.what());
+        failed ++;
+    }
+    unlink(input.c_str());
+    std::printf("%s branch_args\n", failed ? "FAIL" : "ok");
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mir.hpp"
+
+// 测试用的解释器: 顺序执行没有跳转的机器指令, 遇到 ret 结束, 读到没有写过的寄存器或栈槽时抛出异常
+// 访存只支持 sp 加上栈上对象 slot 的地址, 用来执行溢出的代码
+class Interp
+{
+private:
+    std::vector<int> value;
+    std::vector<char> known;
+    std::map<std::pair<int, int>, int> stack;
+
+public:
+    Interp(int regs) : value(regs, 0), known(regs, false)
+    {
+        known[ZERO] = true;
+
+        return;
+    }
+
+    void set(int r, int v)
+    {
+        if(r != ZERO)
+        {
+            value[r] = v;
+            known[r] = true;
+        }
+
+        return;
+    }
+
+    int get(int r)
+    {
+        if(!known[r])
+            throw std::runtime_error("read of undefined register " + std::to_string(r));
+
+        return value[r];
+    }
+
+    void run(const std::vector<MInst> &insts)
+    {
+        for(auto &inst : insts)
+        {
+            if(inst.op == RV_RET)
+                break;
+            if(inst.op == RV_LW || inst.op == RV_SW)
+            {
+                if(inst.rs1 != SP || inst.slot == -1)
+                    throw std::runtime_error("unsupported memory access");
+                std::pair<int, int> addr(inst.slot, inst.imm);
+                if(inst.op == RV_SW)
+                    stack[addr] = get(inst.rs2);
+                else if(!stack.count(addr))
+                    throw std::runtime_error("read of undefined stack slot " + std::to_string(inst.slot));
+                else
+                    set(inst.rd, stack[addr]);
+                continue;
+            }
+
+            unsigned a = inst.rs1 == -1 ? 0 : get(inst.rs1), b = inst.rs2 == -1 ? 0 : get(inst.rs2), imm = inst.imm;
+            int x = a, y = b;
+            switch(inst.op)
+            {
+            case RV_LI:
+                set(inst.rd, inst.imm);
+                break;
+            case RV_MV:
+                set(inst.rd, x);
+                break;
+            case RV_ADD:
+                set(inst.rd, a + b);
+                break;
+            case RV_SUB:
+                set(inst.rd, a - b);
+                break;
+            case RV_MUL:
+                set(inst.rd, a * b);
+                break;
+            case RV_MULH:
+                set(inst.rd, (int)((long long)x * y >> 32));
+                break;
+            case RV_DIV:
+                set(inst.rd, !y ? -1 : x == (int)(1U << 31) && y == -1 ? x : x / y);
+                break;
+            case RV_REM:
+                set(inst.rd, !y ? x : y == -1 ? 0 : x % y);
+                break;
+            case RV_AND:
+                set(inst.rd, a & b);
+                break;
+            case RV_OR:
+                set(inst.rd, a | b);
+                break;
+            case RV_XOR:
+                set(inst.rd, a ^ b);
+                break;
+            case RV_SLL:
+                set(inst.rd, a << (b & 31));
+                break;
+            case RV_SRL:
+                set(inst.rd, a >> (b & 31));
+                break;
+            case RV_SRA:
+                set(inst.rd, x >> (b & 31));
+                break;
+            case RV_SLT:
+                set(inst.rd, x < y);
+                break;
+            case RV_SLTU:
+                set(inst.rd, a < b);
+                break;
+            case RV_SGT:
+                set(inst.rd, x > y);
+                break;
+            case RV_ADDI:
+                set(inst.rd, a + imm);
+                break;
+            case RV_ANDI:
+                set(inst.rd, a & imm);
+                break;
+            case RV_ORI:
+                set(inst.rd, a | imm);
+                break;
+            case RV_XORI:
+                set(inst.rd, a ^ imm);
+                break;
+            case RV_SLLI:
+                set(inst.rd, a << (imm & 31));
+                break;
+            case RV_SRLI:
+                set(inst.rd, a >> (imm & 31));
+                break;
+            case RV_SRAI:
+                set(inst.rd, x >> (imm & 31));
+                break;
+            case RV_SLTI:
+                set(inst.rd, x < inst.imm);
+                break;
+            case RV_SLTIU:
+                set(inst.rd, a < imm);
+                break;
+            case RV_SEQZ:
+                set(inst.rd, !a);
+                break;
+            case RV_SNEZ:
+                set(inst.rd, a != 0);
+                break;
+            default:
+                throw std::runtime_error("unsupported instruction " + std::to_string(inst.op));
+            }
+        }
+
+        return;
+    }
+};
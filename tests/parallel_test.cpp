@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include "ast.hpp"
+#include "context.hpp"
+#include "koopa.h"
+#include "lexer.hpp"
+#include "output.hpp"
+#include "riscv.hpp"
+#include "schedule.hpp"
+#include "sysy.tab.hpp"
+
+// 多个函数, 其中几个的条件跳转超出范围, 需要展开成带 _skip 标号的长跳转
+static std::string program(void)
+{
+    std::ostringstream res;
+
+    res << "int g[16];\n";
+    for(int f = 0; f < 12; f ++)
+    {
+        res << "int f" << f << "(int x, int y) {\n";
+        res << "  int s = " << f << ";\n";
+        res << "  while (x > 0) {\n";
+        res << "    if (x % " << f + 2 << " == 0) {\n";
+        for(int i = 0; i < (f % 4 == 1 ? 800 : 4); i ++)
+            res << "      s = s * " << i % 7 + 3 << " + g[(x + " << i << ") % 16] / " << i % 5 + 3 << ";\n";
+        res << "    }\n";
+        res << "    x = x - 1; y = y + s;\n";
+        res << "  }\n";
+        res << "  return s + y;\n";
+        res << "}\n";
+    }
+    res << "int main() {\n  int s = 0;\n";
+    for(int f = 0; f < 12; f ++)
+        res << "  s = s + f" << f << "(" << f + 10 << ", s);\n";
+    res << "  return s % 256;\n}\n";
+
+    return res.str();
+}
+
+static std::string read_file(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream res;
+    res << in.rdbuf();
+
+    return res.str();
+}
+
+static std::string compile(const std::string &input, int jobs)
+{
+    Context context;
+    Lexer lexer(input.c_str());
+    ParseState state(lexer);
+    std::unique_ptr<BaseAST> ast;
+    yyparse(ast, state);
+
+    std::unique_ptr<CompUnitAST> comp_ast((CompUnitAST *)ast.release());
+    koopa_raw_program_t krp = comp_ast->to_koopa_program();
+
+    std::string path = input + "." + std::to_string(jobs) + ".S";
+    Output out(path.c_str());
+    koopa2riscv(&krp, out, find_pipeline("generic"), jobs);
+    out.close();
+    std::string res = read_file(path);
+    unlink(path.c_str());
+
+    return res;
+}
+
+// 串行和并行生成的汇编逐字节相同
+int main(void)
+{
+    std::string input = "/tmp/parallel_test_" + std::to_string(getpid()) + ".sy";
+    std::ofstream(input) << program();
+
+    int failed = 0;
+    try
+    {
+        std::string serial = compile(input, 1);
+        if(serial.find("_skip") == std::string::npos)
+        {
+            std::fprintf(stderr, "parallel_test: no long branch in the test program\n");
+            failed ++;
+        }
+        for(int jobs : {2, 4, 8})
+            if(compile(input, jobs) != serial)
+            {
+                std::fprintf(stderr, "parallel_test: -j %d differs from -j 1\n", jobs);
+                failed ++;
+            }
+    }
+    catch(const std::exception &e)
+    {
+        std::fprintf(stderr, "parallel_test: %s\n", e.what());
+        failed ++;
+    }
+    unlink(input.c_str());
+    std::printf("%s parallel\n", failed ? "FAIL" : "ok");
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <exception>
+#include "mir.hpp"
+#include "mir_interp.hpp"
+#include "peephole.hpp"
+
+// li a, 5; mv t, a; mv u, a; add x, t, y: 向前传播把 add 改为读 a 之后, mv u, a 不能再把 a 的定义改写成 u
+static bool copy_after_forward(void)
+{
+    MFunc func("copy_after_forward");
+    func.blocks.push_back({"entry", {
+        MInst(RV_LI, T3, -1, -1, 5),
+        MInst(RV_MV, T4, T3),
+        MInst(RV_MV, S2, T3),
+        MInst(RV_ADD, S3, T4, S4),
+        MInst(RV_RET)
+    }});
+
+    Peephole peephole;
+    peephole.run(func);
+
+    Interp interp(VREG);
+    interp.set(S4, 7);
+    interp.run(func.blocks[0].insts);
+
+    return interp.get(S2) == 5 && interp.get(S3) == 12;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *name;
+        bool (*run)(void);
+    } tests[] = {
+        {"copy_after_forward", copy_after_forward}
+    };
+    int failed = 0;
+
+    for(auto &test : tests)
+    {
+        bool ok;
+        try
+        {
+            ok = test.run();
+        }
+        catch(const std::exception &e)
+        {
+            std::fprintf(stderr, "%s: %s\n", test.name, e.what());
+            ok = false;
+        }
+        if(!ok)
+            failed ++;
+        std::printf("%s %s\n", ok ? "ok" : "FAIL", test.name);
+    }
+
+    return failed ? 1 : 0;
+}
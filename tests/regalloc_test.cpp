@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <exception>
+#include <vector>
+#include "mir.hpp"
+#include "mir_interp.hpp"
+#include "regalloc.hpp"
+
+// 寄存器远远不够时, 多数值和它们的复制都被溢出: mv 的两端都分到 t0, 复制本身可以删掉, 但写回栈槽必须保留
+static bool spilled_copy(void)
+{
+    const int N = 40;
+    MFunc func("spilled_copy");
+    std::vector<MInst> insts;
+    std::vector<int> vals, copies;
+    int expect = 0;
+
+    for(int i = 0; i < N; i ++)
+    {
+        vals.push_back(func.vreg());
+        insts.emplace_back(RV_LI, vals[i], -1, -1, i * 7 + 1);
+        expect += (i * 7 + 1) * 2;
+    }
+    for(int i = 0; i < N; i ++)
+    {
+        copies.push_back(func.vreg());
+        insts.emplace_back(RV_MV, copies[i], vals[i]);
+    }
+    int sum = func.vreg();
+    insts.emplace_back(RV_LI, sum, -1, -1, 0);
+    for(int i = 0; i < N; i ++)
+    {
+        insts.emplace_back(RV_ADD, sum, sum, vals[i]);
+        insts.emplace_back(RV_ADD, sum, sum, copies[i]);
+    }
+    insts.emplace_back(RV_MV, A0, sum);
+    insts.emplace_back(RV_RET, -1, -1, -1, 1);
+    func.blocks.push_back({"entry", insts});
+
+    allocate_registers(func);
+
+    Interp interp(VREG);
+    interp.run(func.blocks[0].insts);
+
+    return interp.get(A0) == expect;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *name;
+        bool (*run)(void);
+    } tests[] = {
+        {"spilled_copy", spilled_copy}
+    };
+    int failed = 0;
+
+    for(auto &test : tests)
+    {
+        bool ok;
+        try
+        {
+            ok = test.run();
+        }
+        catch(const std::exception &e)
+        {
+            std::fprintf(stderr, "%s: %s\n", test.name, e.what());
+            ok = false;
+        }
+        if(!ok)
+            failed ++;
+        std::printf("%s %s\n", ok ? "ok" : "FAIL", test.name);
+    }
+
+    return failed ? 1 : 0;
+}